@@ -0,0 +1,278 @@
+#include "CubeMapBatch.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "GlUtil.h"
+
+static const char* kBatchVersion = "#version 330\n";
+static const char* kBatchYuvVersion = "#version 330\n#define YUV_PLANES\n";
+
+// Each instance is one view: a quad over its atlas rect, with the corner's
+// NDC position unprojected the same way the full-screen pass does it. The
+// array sizes match kMaxViews.
+static const char* vsbatch =
+    "layout(std140) uniform Views {\n"
+    "    mat4 inv_mvp[64];\n"
+    "    vec4 rect[64];\n"
+    "};\n"
+    "uniform int base;\n"
+    "out vec3 tex_coord;\n"
+    "void main() {\n"
+    "    int view = base + gl_InstanceID;\n"
+    "    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+    "    gl_Position = vec4(mix(rect[view].xy, rect[view].zw, corner), 0, 1);\n"
+    "    tex_coord = (inv_mvp[view] * vec4(corner * 2.0 - 1.0, 0, 1)).xyz;\n"
+    "}\n";
+
+static const char* fsbatch =
+    "uniform samplerCube samp;\n"
+    "#ifdef YUV_PLANES\n"
+    "uniform samplerCube sampU;\n"
+    "uniform samplerCube sampV;\n"
+    "#endif\n"
+    "in vec3 tex_coord;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "#ifdef YUV_PLANES\n"
+    "    float y = texture(samp, tex_coord).r;\n"
+    "    float u = texture(sampU, tex_coord).r - 0.5;\n"
+    "    float v = texture(sampV, tex_coord).r - 0.5;\n"
+    "    color = vec4(y + 1.402 * v, y - 0.344136 * u - 0.714136 * v, y + 1.772 * u, 1.0);\n"
+    "#else\n"
+    "    color = texture(samp, tex_coord);\n"
+    "#endif\n"
+    "}\n";
+
+static int nextPowerOfTwo(int value)
+{
+    int result = 256;
+    while (result < value) {
+        result *= 2;
+    }
+    return result;
+}
+
+CubeMapBatch::CubeMapBatch()
+    : m_frame(0)
+    , m_shelfX(0)
+    , m_shelfY(0)
+    , m_shelfHeight(0)
+    , m_fb(0)
+    , m_programs()
+    , m_base()
+    , m_ubo(0)
+    , m_vao(0)
+    , m_maxSize(0)
+{
+}
+
+CubeMapBatch::~CubeMapBatch()
+{
+}
+
+int CubeMapBatch::add(PassScheduler& scheduler, const CubeMapDraw& draw)
+{
+    if (!scheduler.context()) {
+        return -1;
+    }
+    if (m_frame != scheduler.frame()) {
+        m_frame = scheduler.frame();
+        m_entries.clear();
+        m_snapshot.reset();
+        m_shelfX = m_shelfY = m_shelfHeight = 0;
+        scheduler.add("GlView batch", [this] { run(); });
+    }
+
+    // Shelf packing: views fill rows left to right, and a row is as tall as
+    // its tallest view.
+    int atlasWidth = m_atlas ? m_atlas->width() : nextPowerOfTwo(std::max(draw.width, 1024));
+    int x = m_shelfX;
+    int y = m_shelfY;
+    int shelfHeight = m_shelfHeight;
+    if (x + draw.width > atlasWidth) {
+        y += shelfHeight;
+        x = 0;
+        shelfHeight = 0;
+    }
+    if (!reserve(scheduler.context(), std::max(atlasWidth, draw.width), y + draw.height)) {
+        return -1;
+    }
+    Entry entry;
+    entry.draw = draw;
+    entry.rect = SkIRect::MakeXYWH(x, y, draw.width, draw.height);
+    m_shelfX = x + draw.width;
+    m_shelfY = y;
+    m_shelfHeight = std::max(shelfHeight, draw.height);
+    m_entries.push_back(entry);
+    return (int)m_entries.size() - 1;
+}
+
+// Grows the atlas in powers of two. Its contents are redrawn every frame, so
+// rects handed out earlier in the frame stay valid.
+bool CubeMapBatch::reserve(GrContext* context, int width, int height)
+{
+    if (m_atlas && m_atlas->width() >= width && m_atlas->height() >= height) {
+        return true;
+    }
+    if (m_atlas) {
+        width = std::max(width, m_atlas->width());
+        height = std::max(height, m_atlas->height());
+    }
+    width = nextPowerOfTwo(width);
+    height = nextPowerOfTwo(height);
+    if (!m_maxSize) {
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_maxSize);
+    }
+    if (width > m_maxSize || height > m_maxSize) {
+        return false;
+    }
+    // On failure the current atlas is kept, so views already placed this
+    // frame still draw.
+    sk_sp<SkSurface> atlas = SkSurface::MakeRenderTarget(context, SkBudgeted::kYes,
+        SkImageInfo::MakeN32Premul(width, height));
+    if (!atlas) {
+        printf("Failed to create %dx%d cubemap atlas\n", width, height);
+        return false;
+    }
+    m_snapshot.reset();
+    m_atlas = atlas;
+    GrBackendObject obj;
+    m_atlas->getRenderTargetHandle(&obj, SkSurface::BackendHandleAccess::kFlushWrite_BackendHandleAccess);
+    m_fb = obj;
+    return true;
+}
+
+bool CubeMapBatch::createPrograms()
+{
+    for (int i = 0; i < 2; ++i) {
+        const char* prefix = i ? kBatchYuvVersion : kBatchVersion;
+        GLuint vId = getShader(vsbatch, GL_VERTEX_SHADER, prefix);
+        GLuint fId = getShader(fsbatch, GL_FRAGMENT_SHADER, prefix);
+        if (!vId || !fId) {
+            glDeleteShader(vId);
+            glDeleteShader(fId);
+            return false;
+        }
+        GLuint program = glCreateProgram();
+        glAttachShader(program, vId);
+        glAttachShader(program, fId);
+        glLinkProgram(program);
+        glDeleteShader(vId);
+        glDeleteShader(fId);
+
+        glUseProgram(program);
+        glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Views"), 0);
+        glUniform1i(glGetUniformLocation(program, "samp"), 0);
+        glUniform1i(glGetUniformLocation(program, "sampU"), 1);
+        glUniform1i(glGetUniformLocation(program, "sampV"), 2);
+        m_base[i] = glGetUniformLocation(program, "base");
+        m_programs[i] = program;
+    }
+    glGenBuffers(1, &m_ubo);
+    glGenVertexArrays(1, &m_vao);
+    return true;
+}
+
+void CubeMapBatch::run()
+{
+    if (m_entries.empty() || !m_atlas) {
+        return;
+    }
+    if (!m_programs[0] && !createPrograms()) {
+        return;
+    }
+
+    // Sampler arrays can't be indexed per instance in GLSL 330, so views are
+    // drawn in runs that share textures.
+    m_order.resize(m_entries.size());
+    for (size_t i = 0; i < m_order.size(); ++i) {
+        m_order[i] = (int)i;
+    }
+    std::sort(m_order.begin(), m_order.end(), [this](int a, int b) {
+        const CubeMapDraw& da = m_entries[a].draw;
+        const CubeMapDraw& db = m_entries[b].draw;
+        if (da.yuv != db.yuv) {
+            return da.yuv < db.yuv;
+        }
+        return da.textures[0] < db.textures[0];
+    });
+
+    const float width = (float)m_atlas->width();
+    const float height = (float)m_atlas->height();
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fb);
+    glViewport(0, 0, m_atlas->width(), m_atlas->height());
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBindVertexArray(m_vao);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_ubo);
+
+    int bound = -1;
+    for (size_t chunk = 0; chunk < m_order.size(); chunk += kMaxViews) {
+        int count = (int)std::min(m_order.size() - chunk, (size_t)kMaxViews);
+        for (int i = 0; i < count; ++i) {
+            const Entry& entry = m_entries[m_order[chunk + i]];
+            memcpy(m_block.inv_mvp[i], entry.draw.inv_mvp, sizeof(m_block.inv_mvp[i]));
+            m_block.rect[i][0] = entry.rect.left() / width * 2 - 1;
+            m_block.rect[i][1] = entry.rect.top() / height * 2 - 1;
+            m_block.rect[i][2] = entry.rect.right() / width * 2 - 1;
+            m_block.rect[i][3] = entry.rect.bottom() / height * 2 - 1;
+        }
+        // Orphaning keeps the driver from waiting on the previous chunk.
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(m_block), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(m_block), &m_block);
+
+        for (int first = 0; first < count;) {
+            const CubeMapDraw& draw = m_entries[m_order[chunk + first]].draw;
+            int last = first + 1;
+            while (last < count && m_entries[m_order[chunk + last]].draw.textures[0] == draw.textures[0]) {
+                ++last;
+            }
+            int variant = draw.yuv ? 1 : 0;
+            if (bound != variant) {
+                glUseProgram(m_programs[variant]);
+                bound = variant;
+            }
+            for (int t = (draw.yuv ? 2 : 0); t >= 0; --t) {
+                glActiveTexture(GL_TEXTURE0 + t);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, draw.textures[t]);
+            }
+            glUniform1i(m_base[variant], first);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, last - first);
+            first = last;
+        }
+    }
+    glBindVertexArray(0);
+}
+
+// The atlas has a bottom-left origin, so GL rows count up from the bottom of
+// the snapshot. Rects are packed edge to edge, so the filter is kept inside
+// src to avoid pulling in the neighbouring view.
+void CubeMapBatch::composite(SkCanvas& canvas, int slot, const SkRect& dst, const SkPaint& paint)
+{
+    if (slot < 0 || slot >= (int)m_entries.size() || !m_atlas) {
+        return;
+    }
+    if (!m_snapshot) {
+        m_snapshot = m_atlas->makeImageSnapshot();
+    }
+    const SkIRect& rect = m_entries[slot].rect;
+    SkRect src = SkRect::MakeXYWH(SkIntToScalar(rect.x()), SkIntToScalar(m_atlas->height() - rect.bottom()),
+        SkIntToScalar(rect.width()), SkIntToScalar(rect.height()));
+    canvas.drawImageRect(m_snapshot, src, dst, &paint, SkCanvas::kStrict_SrcRectConstraint);
+}
+
+void CubeMapBatch::release()
+{
+    m_snapshot.reset();
+    m_atlas.reset();
+    m_entries.clear();
+    glDeleteProgram(m_programs[0]);
+    glDeleteProgram(m_programs[1]);
+    glDeleteBuffers(1, &m_ubo);
+    glDeleteVertexArrays(1, &m_vao);
+    m_programs[0] = m_programs[1] = 0;
+    m_ubo = 0;
+    m_vao = 0;
+}
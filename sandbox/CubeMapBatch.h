@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <SkCanvas.h>
+#include <SkSurface.h>
+
+#include "PassScheduler.h"
+
+struct CubeMapDraw
+{
+    GLuint textures[3];
+    bool yuv;
+    GLfloat inv_mvp[16];
+    int width;
+    int height;
+};
+
+// Renders every cubemap view queued in a frame into one shared atlas with a
+// single pass. Views using the same textures are drawn as one instanced
+// call, with their matrices and atlas rects in a uniform buffer.
+class CubeMapBatch
+{
+    static const int kMaxViews = 64;
+
+    struct Entry
+    {
+        CubeMapDraw draw;
+        SkIRect rect;
+    };
+
+    struct ViewBlock
+    {
+        GLfloat inv_mvp[kMaxViews][16];
+        GLfloat rect[kMaxViews][4];
+    };
+
+    std::vector<Entry> m_entries;
+    std::vector<int> m_order;
+    ViewBlock m_block;
+    unsigned m_frame;
+    int m_shelfX;
+    int m_shelfY;
+    int m_shelfHeight;
+
+    sk_sp<SkSurface> m_atlas;
+    sk_sp<SkImage> m_snapshot;
+    GLuint m_fb;
+    GLuint m_programs[2];
+    GLint m_base[2];
+    GLuint m_ubo;
+    GLuint m_vao;
+    GLint m_maxSize;
+
+    bool reserve(GrContext* context, int width, int height);
+    bool createPrograms();
+    void run();
+
+public:
+    CubeMapBatch();
+    ~CubeMapBatch();
+
+    // Queues a view for this frame's batched pass, returning the slot to
+    // composite from, or -1 if the atlas can't hold it.
+    int add(PassScheduler& scheduler, const CubeMapDraw& draw);
+    void composite(SkCanvas& canvas, int slot, const SkRect& dst, const SkPaint& paint);
+    void release();
+};
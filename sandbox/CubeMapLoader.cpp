@@ -0,0 +1,197 @@
+#include "CubeMapLoader.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <SkPixmap.h>
+
+#include "Equirect.h"
+#include "TaskPool.h"
+
+static const char* kFaceNames[6] = {
+    "/posx.jpg", "/negx.jpg", "/posy.jpg", "/negy.jpg", "/posz.jpg", "/negz.jpg",
+};
+
+// Decodes wait on conversion bands, so they get their own threads to avoid
+// starving the pool they wait on.
+static TaskPool& decodePool()
+{
+    static TaskPool pool(2);
+    return pool;
+}
+
+static TaskPool& convertPool()
+{
+    static TaskPool pool;
+    return pool;
+}
+
+// A path with an extension is a single equirectangular panorama, otherwise a
+// directory holding the six faces.
+static bool isPanorama(const std::string& path)
+{
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    return dot != std::string::npos && (slash == std::string::npos || dot > slash);
+}
+
+static bool decodePanorama(const std::string& path, int faceSize, CubeMapData* data)
+{
+    SkBitmap panorama;
+    SkISize fullSize;
+    if (!loadScaledImage(path, faceSize * 4, &panorama, &fullSize)) {
+        printf("Failed to load %s\n", path.c_str());
+        return false;
+    }
+    SkPixmap pixmap;
+    int size = std::min(faceSize, panorama.width() / 4);
+    if (!panorama.peekPixels(&pixmap) || !equirectToCubeMap(pixmap, size, data->faces, convertPool())) {
+        printf("Failed to convert %s\n", path.c_str());
+        return false;
+    }
+    data->faceSize = size;
+    data->sourceFaceSize = fullSize.width() / 4;
+    return true;
+}
+
+// Keeps the faces as JPEG planes when every face decodes to square planes at
+// no more than faceSize. Chroma is typically half size.
+static bool decodeYuvFaces(const std::string& path, int faceSize, CubeMapData* data)
+{
+    for (int i = 0; i < 6; ++i) {
+        YUVPlanes& face = data->planes[i];
+        if (!loadYUVPlanes(path + kFaceNames[i], faceSize, &face) || face.colorSpace != kJPEG_SkYUVColorSpace) {
+            return false;
+        }
+        for (int p = 0; p < 3; ++p) {
+            SkISize size = face.sizes.fSizes[p];
+            if (size.width() != size.height() || size != data->planes[0].sizes.fSizes[p]) {
+                return false;
+            }
+        }
+    }
+    data->yuv = true;
+    data->faceSize = data->planes[0].sizes.fSizes[0].width();
+    data->sourceFaceSize = data->faceSize;
+    return true;
+}
+
+static bool decodeFaces(const std::string& path, int faceSize, CubeMapData* data)
+{
+    for (int i = 0; i < 6; ++i) {
+        SkISize fullSize;
+        if (!loadScaledImage(path + kFaceNames[i], faceSize, &data->faces[i], &fullSize)) {
+            printf("Failed to load %s\n", (path + kFaceNames[i]).c_str());
+            return false;
+        }
+        data->faceSize = data->faces[i].width();
+        data->sourceFaceSize = fullSize.width();
+    }
+    return true;
+}
+
+// 2x2 box filter. Odd sizes clamp the second tap to the last row or column.
+static void downsample(const CubeMapLevel& src, int bpp, uint8_t* dst, int size)
+{
+    int last = src.size - 1;
+    for (int y = 0; y < size; ++y) {
+        const uint8_t* row0 = src.pixels + std::min(2 * y, last) * src.rowBytes;
+        const uint8_t* row1 = src.pixels + std::min(2 * y + 1, last) * src.rowBytes;
+        uint8_t* out = dst + size_t(y) * size * bpp;
+        for (int x = 0; x < size; ++x) {
+            int x0 = std::min(2 * x, last) * bpp;
+            int x1 = std::min(2 * x + 1, last) * bpp;
+            for (int c = 0; c < bpp; ++c) {
+                out[x * bpp + c] = uint8_t((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+            }
+        }
+    }
+}
+
+static void buildMips(CubeMapData* data)
+{
+    int bpp = data->bytesPerPixel();
+    for (int p = 0; p < data->planeCount(); ++p) {
+        for (int i = 0; i < 6; ++i) {
+            CubeMapLevel base;
+            if (data->yuv) {
+                base.pixels = (const uint8_t*)data->planes[i].planes[p];
+                base.rowBytes = data->planes[i].sizes.fWidthBytes[p];
+                base.size = data->planes[i].sizes.fSizes[p].width();
+            } else {
+                base.pixels = (const uint8_t*)data->faces[i].getPixels();
+                base.rowBytes = data->faces[i].rowBytes();
+                base.size = data->faces[i].width();
+            }
+            std::vector<CubeMapLevel>& levels = data->levels[p][i];
+            levels.clear();
+            levels.push_back(base);
+            while (levels.back().size > 1) {
+                const CubeMapLevel& src = levels.back();
+                CubeMapLevel mip;
+                mip.size = src.size / 2;
+                mip.rowBytes = size_t(mip.size) * bpp;
+                data->mipStorage.emplace_back(new uint8_t[mip.rowBytes * mip.size]);
+                mip.pixels = data->mipStorage.back().get();
+                downsample(src, bpp, data->mipStorage.back().get(), mip.size);
+                levels.push_back(mip);
+            }
+        }
+    }
+}
+
+bool decodeCubeMap(const std::string& path, int faceSize, CubeMapData* data)
+{
+    bool decoded;
+    if (isPanorama(path)) {
+        decoded = decodePanorama(path, faceSize, data);
+    } else if (decodeYuvFaces(path, faceSize, data)) {
+        decoded = true;
+    } else {
+        *data = CubeMapData();
+        decoded = decodeFaces(path, faceSize, data);
+    }
+    if (decoded) {
+        buildMips(data);
+    }
+    return decoded;
+}
+
+struct CubeMapLoader::Job
+{
+    std::unique_ptr<CubeMapData> data;
+    std::atomic<bool> done;
+
+    Job()
+        : done(false)
+    {
+    }
+};
+
+void CubeMapLoader::start(const std::string& path, int faceSize)
+{
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    m_job = job;
+    decodePool().add([job, path, faceSize] {
+        std::unique_ptr<CubeMapData> data(new CubeMapData());
+        if (decodeCubeMap(path, faceSize, data.get())) {
+            job->data = std::move(data);
+        }
+        job->done = true;
+    });
+}
+
+void CubeMapLoader::cancel()
+{
+    m_job.reset();
+}
+
+bool CubeMapLoader::poll(std::unique_ptr<CubeMapData>* data)
+{
+    if (!m_job || !m_job->done) {
+        return false;
+    }
+    *data = std::move(m_job->data);
+    m_job.reset();
+    return true;
+}
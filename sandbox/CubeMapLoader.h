@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <SkBitmap.h>
+
+#include "GlUtil.h"
+
+struct CubeMapLevel
+{
+    const uint8_t* pixels;
+    size_t rowBytes;
+    int size;
+};
+
+// Decoded faces ordered like GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, either as
+// N32 bitmaps or, when yuv is set, as JPEG planes. levels holds the full mip
+// chain of every plane and face, built on the decode thread so uploads never
+// have to generate mipmaps.
+struct CubeMapData
+{
+    bool yuv;
+    SkBitmap faces[6];
+    YUVPlanes planes[6];
+    int faceSize;
+    int sourceFaceSize;
+    std::vector<CubeMapLevel> levels[3][6];
+    std::vector<std::unique_ptr<uint8_t[]>> mipStorage;
+
+    CubeMapData()
+        : yuv(false)
+        , faceSize(0)
+        , sourceFaceSize(0)
+    {
+    }
+
+    int planeCount() const { return yuv ? 3 : 1; }
+    int bytesPerPixel() const { return yuv ? 1 : 4; }
+};
+
+bool decodeCubeMap(const std::string& path, int faceSize, CubeMapData* data);
+
+// Runs decodeCubeMap on a background thread. Starting a new decode abandons
+// the one in flight.
+class CubeMapLoader
+{
+    struct Job;
+    std::shared_ptr<Job> m_job;
+
+public:
+    void start(const std::string& path, int faceSize);
+    void cancel();
+    bool isPending() const { return m_job != nullptr; }
+    // Returns true once the decode has finished, leaving the result, or null
+    // on failure, in data.
+    bool poll(std::unique_ptr<CubeMapData>* data);
+};
@@ -0,0 +1,192 @@
+#include "Equirect.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EQUIRECT_SSE2
+#include <emmintrin.h>
+#endif
+
+static const float kPi = 3.14159265358979f;
+static const int kBandRows = 32;
+
+// Cube face direction for face coordinates (s, t) in [-1, 1] is
+// origin + s * right + t * down.
+struct FaceBasis
+{
+    float origin[3];
+    float right[3];
+    float down[3];
+};
+
+static const FaceBasis kFaces[6] = {
+    { {  1,  0,  0 }, {  0, 0, -1 }, { 0, -1,  0 } },
+    { { -1,  0,  0 }, {  0, 0,  1 }, { 0, -1,  0 } },
+    { {  0,  1,  0 }, {  1, 0,  0 }, { 0,  0,  1 } },
+    { {  0, -1,  0 }, {  1, 0,  0 }, { 0,  0, -1 } },
+    { {  0,  0,  1 }, {  1, 0,  0 }, { 0, -1,  0 } },
+    { {  0,  0, -1 }, { -1, 0,  0 }, { 0, -1,  0 } },
+};
+
+struct Source
+{
+    const uint32_t* pixels;
+    size_t stride;
+    int width;
+    int height;
+};
+
+static inline uint32_t sampleBilinear(const Source& src, int x0, int y0, float ax, float ay)
+{
+    x0 = ((x0 % src.width) + src.width) % src.width;
+    int x1 = x0 + 1 == src.width ? 0 : x0 + 1;
+    int y1 = std::min(std::max(y0 + 1, 0), src.height - 1);
+    y0 = std::min(std::max(y0, 0), src.height - 1);
+    const uint32_t* row0 = src.pixels + y0 * src.stride;
+    const uint32_t* row1 = src.pixels + y1 * src.stride;
+
+#ifdef EQUIRECT_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    __m128i p0 = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, row0[x1], row0[x0]), zero);
+    __m128i p1 = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, row1[x1], row1[x0]), zero);
+    __m128 p00 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(p0, zero));
+    __m128 p01 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(p0, zero));
+    __m128 p10 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(p1, zero));
+    __m128 p11 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(p1, zero));
+    __m128 wx = _mm_set1_ps(ax);
+    __m128 top = _mm_add_ps(p00, _mm_mul_ps(_mm_sub_ps(p01, p00), wx));
+    __m128 bottom = _mm_add_ps(p10, _mm_mul_ps(_mm_sub_ps(p11, p10), wx));
+    __m128 c = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), _mm_set1_ps(ay)));
+    __m128i ci = _mm_cvtps_epi32(c);
+    ci = _mm_packs_epi32(ci, ci);
+    return (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(ci, ci));
+#else
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        float p00 = float((row0[x0] >> shift) & 0xFF);
+        float p01 = float((row0[x1] >> shift) & 0xFF);
+        float p10 = float((row1[x0] >> shift) & 0xFF);
+        float p11 = float((row1[x1] >> shift) & 0xFF);
+        float top = p00 + (p01 - p00) * ax;
+        float bottom = p10 + (p11 - p10) * ax;
+        int c = int(top + (bottom - top) * ay + 0.5f);
+        result |= uint32_t(std::min(std::max(c, 0), 255)) << shift;
+    }
+    return result;
+#endif
+}
+
+static inline void samplePixel(const Source& src, float x, float y, float z, uint32_t* dst)
+{
+    float u = 0.5f + atan2f(x, -z) * (0.5f / kPi);
+    float v = 0.5f - atan2f(y, sqrtf(x * x + z * z)) * (1 / kPi);
+    float fx = u * src.width - 0.5f;
+    float fy = v * src.height - 0.5f;
+    float x0 = floorf(fx);
+    float y0 = floorf(fy);
+    *dst = sampleBilinear(src, int(x0), int(y0), fx - x0, fy - y0);
+}
+
+#ifdef EQUIRECT_SSE2
+static inline __m128 select_ps(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// atan2 with a minimax polynomial for atan on [0, 1], max error about 1e-5.
+static inline __m128 atan2_ps(__m128 y, __m128 x)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 ax = _mm_andnot_ps(signMask, x);
+    __m128 ay = _mm_andnot_ps(signMask, y);
+    __m128 a = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(1e-30f)));
+    __m128 s = _mm_mul_ps(a, a);
+    __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.0464964749f), s), _mm_set1_ps(0.15931422f));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(-0.327622764f));
+    r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r, s), a), a);
+    r = select_ps(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(kPi / 2), r), r);
+    r = select_ps(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(kPi), r), r);
+    return _mm_or_ps(r, _mm_and_ps(y, signMask));
+}
+
+static inline __m128i floor_epi32(__m128 v)
+{
+    __m128i i = _mm_cvttps_epi32(v);
+    return _mm_add_epi32(i, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(i), v)));
+}
+#endif
+
+static void convertRows(const Source& src, const FaceBasis& basis, SkBitmap& face, int rowBegin, int rowEnd)
+{
+    const int size = face.width();
+    const float scale = 2.0f / size;
+    for (int row = rowBegin; row < rowEnd; ++row) {
+        uint32_t* dst = face.getAddr32(0, row);
+        float t = (row + 0.5f) * scale - 1;
+        float bx = basis.origin[0] + t * basis.down[0];
+        float by = basis.origin[1] + t * basis.down[1];
+        float bz = basis.origin[2] + t * basis.down[2];
+        int col = 0;
+#ifdef EQUIRECT_SSE2
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 width = _mm_set1_ps(float(src.width));
+        const __m128 height = _mm_set1_ps(float(src.height));
+        alignas(16) int x0[4];
+        alignas(16) int y0[4];
+        alignas(16) float ax[4];
+        alignas(16) float ay[4];
+        for (; col + 4 <= size; col += 4) {
+            __m128 s = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(col + 0.5f)),
+                _mm_set1_ps(scale)), _mm_set1_ps(1.0f));
+            __m128 x = _mm_add_ps(_mm_set1_ps(bx), _mm_mul_ps(s, _mm_set1_ps(basis.right[0])));
+            __m128 y = _mm_add_ps(_mm_set1_ps(by), _mm_mul_ps(s, _mm_set1_ps(basis.right[1])));
+            __m128 z = _mm_add_ps(_mm_set1_ps(bz), _mm_mul_ps(s, _mm_set1_ps(basis.right[2])));
+            __m128 horizontal = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(z, z)));
+            __m128 u = _mm_add_ps(half, _mm_mul_ps(atan2_ps(x, _mm_sub_ps(_mm_setzero_ps(), z)), _mm_set1_ps(0.5f / kPi)));
+            __m128 v = _mm_sub_ps(half, _mm_mul_ps(atan2_ps(y, horizontal), _mm_set1_ps(1 / kPi)));
+            __m128 fx = _mm_sub_ps(_mm_mul_ps(u, width), half);
+            __m128 fy = _mm_sub_ps(_mm_mul_ps(v, height), half);
+            __m128i ix = floor_epi32(fx);
+            __m128i iy = floor_epi32(fy);
+            _mm_store_si128((__m128i*)x0, ix);
+            _mm_store_si128((__m128i*)y0, iy);
+            _mm_store_ps(ax, _mm_sub_ps(fx, _mm_cvtepi32_ps(ix)));
+            _mm_store_ps(ay, _mm_sub_ps(fy, _mm_cvtepi32_ps(iy)));
+            for (int i = 0; i < 4; ++i) {
+                dst[col + i] = sampleBilinear(src, x0[i], y0[i], ax[i], ay[i]);
+            }
+        }
+#endif
+        for (; col < size; ++col) {
+            float s = (col + 0.5f) * scale - 1;
+            samplePixel(src, bx + s * basis.right[0], by + s * basis.right[1], bz + s * basis.right[2], &dst[col]);
+        }
+    }
+}
+
+bool equirectToCubeMap(const SkPixmap& src, int faceSize, SkBitmap faces[6], TaskPool& pool)
+{
+    if (src.bytesPerPixel() != 4 || src.width() < 2 || src.height() < 2 || faceSize <= 0) {
+        return false;
+    }
+    Source source = { (const uint32_t*)src.addr(), src.rowBytes() / 4, src.width(), src.height() };
+    for (int f = 0; f < 6; ++f) {
+        if (!faces[f].tryAllocPixels(src.info().makeWH(faceSize, faceSize))) {
+            return false;
+        }
+    }
+
+    TaskGroup group(pool);
+    for (int f = 0; f < 6; ++f) {
+        for (int row = 0; row < faceSize; row += kBandRows) {
+            int end = std::min(row + kBandRows, faceSize);
+            SkBitmap* face = &faces[f];
+            group.add([source, f, face, row, end] {
+                convertRows(source, kFaces[f], *face, row, end);
+            });
+        }
+    }
+    group.wait();
+    return true;
+}
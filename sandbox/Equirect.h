@@ -0,0 +1,11 @@
+#pragma once
+
+#include <SkBitmap.h>
+#include <SkPixmap.h>
+
+#include "TaskPool.h"
+
+// Resamples an equirectangular panorama into six square faces, ordered like
+// GL_TEXTURE_CUBE_MAP_POSITIVE_X + i. Pixels are treated as four 8-bit channels
+// in whatever order the source uses.
+bool equirectToCubeMap(const SkPixmap& src, int faceSize, SkBitmap faces[6], TaskPool& pool);
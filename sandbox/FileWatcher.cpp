@@ -0,0 +1,121 @@
+#include "FileWatcher.h"
+
+#include <cstdio>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+FileWatcher::FileWatcher()
+    : m_handle(INVALID_HANDLE_VALUE)
+{
+}
+
+#else
+
+FileWatcher::FileWatcher()
+    : m_fd(-1)
+{
+}
+
+#endif
+
+FileWatcher::~FileWatcher()
+{
+    stop();
+}
+
+bool FileWatcher::watch(const std::string& path)
+{
+    stop();
+    std::string directory = path;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || (st.st_mode & S_IFMT) != S_IFDIR) {
+        size_t slash = path.find_last_of("/\\");
+        directory = slash == std::string::npos ? "." : path.substr(0, slash);
+        m_name = slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+#ifdef _WIN32
+    // Change notifications don't say which file changed, so on Windows any
+    // write in the directory counts.
+    m_handle = FindFirstChangeNotificationA(directory.c_str(), FALSE,
+        FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+    if (m_handle == INVALID_HANDLE_VALUE) {
+        printf("Failed to watch %s\n", directory.c_str());
+        return false;
+    }
+#else
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        return false;
+    }
+    if (inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        printf("Failed to watch %s\n", directory.c_str());
+        stop();
+        return false;
+    }
+#endif
+    return true;
+}
+
+void FileWatcher::stop()
+{
+#ifdef _WIN32
+    if (m_handle != INVALID_HANDLE_VALUE) {
+        FindCloseChangeNotification(m_handle);
+        m_handle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+    m_name.clear();
+}
+
+bool FileWatcher::isWatching() const
+{
+#ifdef _WIN32
+    return m_handle != INVALID_HANDLE_VALUE;
+#else
+    return m_fd >= 0;
+#endif
+}
+
+bool FileWatcher::poll()
+{
+    bool changed = false;
+#ifdef _WIN32
+    while (m_handle != INVALID_HANDLE_VALUE && WaitForSingleObject(m_handle, 0) == WAIT_OBJECT_0) {
+        changed = true;
+        if (!FindNextChangeNotification(m_handle)) {
+            stop();
+        }
+    }
+#else
+    if (m_fd < 0) {
+        return false;
+    }
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(m_fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + length;) {
+            const inotify_event* event = (const inotify_event*)p;
+            if (m_name.empty() || (event->len && m_name == event->name)) {
+                changed = true;
+            }
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+#endif
+    return changed;
+}
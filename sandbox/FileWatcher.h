@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+// Watches a directory, or a single file through its parent directory, for
+// files being written or moved in. Polled without blocking.
+class FileWatcher
+{
+#ifdef _WIN32
+    void* m_handle;
+#else
+    int m_fd;
+#endif
+    std::string m_name;
+
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    bool watch(const std::string& path);
+    void stop();
+    bool isWatching() const;
+    bool poll();
+};
@@ -0,0 +1,302 @@
+#include <GL/glew.h>
+#include "FrameCapture.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <SkBitmap.h>
+#include <SkImageEncoder.h>
+
+#include "Clock.h"
+
+FrameCapture::FrameCapture()
+    : m_next(0)
+    , m_frameIndex(0)
+    , m_dropped(0)
+    , m_format(CaptureFormat::Png)
+    , m_y4m(nullptr)
+    , m_frameRate(60)
+    , m_rateOffset(0)
+    , m_firstTime(0)
+    , m_lastTime(0)
+    , m_y4mWidth(0)
+    , m_y4mHeight(0)
+    , m_stop(false)
+{
+    memset(m_slots, 0, sizeof(m_slots));
+}
+
+FrameCapture::~FrameCapture()
+{
+    stop();
+}
+
+bool FrameCapture::start(const std::string& path, CaptureFormat format)
+{
+    stop();
+    m_path = path;
+    m_format = format;
+    m_frameIndex = 0;
+    m_dropped = 0;
+    if (format == CaptureFormat::Y4m) {
+        m_y4m = fopen(path.c_str(), "wb");
+        if (!m_y4m) {
+            printf("Failed to open %s for capture\n", path.c_str());
+            return false;
+        }
+        m_y4mWidth = 0;
+        m_y4mHeight = 0;
+    }
+    m_stop = false;
+    m_thread = std::thread(&FrameCapture::encodeLoop, this);
+    return true;
+}
+
+void FrameCapture::stop()
+{
+    if (!isRunning()) {
+        return;
+    }
+    // Drain the readbacks still in flight, oldest first.
+    for (int i = 0; i < kSlots; ++i) {
+        collect(m_slots[(m_next + i) % kSlots], true);
+    }
+    for (Slot& s : m_slots) {
+        if (s.pbo) {
+            glDeleteBuffers(1, &s.pbo);
+        }
+    }
+    memset(m_slots, 0, sizeof(m_slots));
+    m_next = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+    if (m_y4m) {
+        if (m_frameRate <= 0 && m_y4mWidth && m_frameIndex > 1 && m_lastTime > m_firstTime) {
+            double fps = (m_frameIndex - 1) / (m_lastTime - m_firstTime);
+            fseek(m_y4m, m_rateOffset, SEEK_SET);
+            fprintf(m_y4m, "%010d", (int)(fps * 1000 + 0.5));
+        }
+        fclose(m_y4m);
+        m_y4m = nullptr;
+    }
+    if (m_dropped) {
+        printf("Capture dropped %d frames\n", m_dropped);
+    }
+}
+
+std::vector<uint8_t> FrameCapture::takeBuffer(size_t size)
+{
+    std::vector<uint8_t> buffer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_freeBuffers.empty()) {
+            buffer.swap(m_freeBuffers.back());
+            m_freeBuffers.pop_back();
+        }
+    }
+    buffer.resize(size);
+    return buffer;
+}
+
+void FrameCapture::push(Frame&& frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.size() >= kMaxQueued) {
+            ++m_dropped;
+            m_freeBuffers.push_back(std::move(frame.pixels));
+            return;
+        }
+        m_queue.push_back(std::move(frame));
+    }
+    m_cv.notify_one();
+}
+
+// Returns true when the readback went through GL and changed its bindings.
+bool FrameCapture::capture(SkSurface* surface, GrGLuint framebuffer)
+{
+    if (!isRunning() || !surface) {
+        return false;
+    }
+    int width = surface->width();
+    int height = surface->height();
+    size_t size = size_t(width) * height * 4;
+    m_lastTime = clockSeconds();
+    if (m_frameIndex == 0) {
+        m_firstTime = m_lastTime;
+    }
+
+    if (!surface->getCanvas()->getGrContext()) {
+        Frame frame = { takeBuffer(size), width, height, m_frameIndex++, false };
+        SkImageInfo info = SkImageInfo::Make(width, height, kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+        if (surface->readPixels(info, frame.pixels.data(), width * 4, 0, 0)) {
+            push(std::move(frame));
+        }
+        return false;
+    }
+
+    for (int i = 0; i < kSlots; ++i) {
+        collect(m_slots[(m_next + i) % kSlots], false);
+    }
+    Slot& slot = m_slots[m_next];
+    collect(slot, true);
+    m_next = (m_next + 1) % kSlots;
+
+    if (!slot.pbo) {
+        glGenBuffers(1, &slot.pbo);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (slot.width != width || slot.height != height) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.width = width;
+        slot.height = height;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.index = m_frameIndex++;
+    return true;
+}
+
+bool FrameCapture::collect(Slot& slot, bool wait)
+{
+    if (!slot.fence) {
+        return false;
+    }
+    GLsync fence = (GLsync)slot.fence;
+    GLenum status = glClientWaitSync(fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? GLuint64(1000000000) : 0);
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+        if (wait) {
+            printf("Capture readback of frame %d failed\n", slot.index);
+            glDeleteSync(fence);
+            slot.fence = nullptr;
+        }
+        return false;
+    }
+    glDeleteSync(fence);
+    slot.fence = nullptr;
+
+    size_t size = size_t(slot.width) * slot.height * 4;
+    Frame frame = { takeBuffer(size), slot.width, slot.height, slot.index, true };
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (data) {
+        memcpy(frame.pixels.data(), data, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (data) {
+        push(std::move(frame));
+    }
+    return data != nullptr;
+}
+
+void FrameCapture::encodeLoop()
+{
+    for (;;) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            frame = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        encode(frame);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_freeBuffers.push_back(std::move(frame.pixels));
+    }
+}
+
+void FrameCapture::encode(Frame& frame)
+{
+    size_t rowBytes = size_t(frame.width) * 4;
+    if (frame.bottomUp) {
+        std::vector<uint8_t> row(rowBytes);
+        uint8_t* top = frame.pixels.data();
+        uint8_t* bottom = top + (frame.height - 1) * rowBytes;
+        for (; top < bottom; top += rowBytes, bottom -= rowBytes) {
+            memcpy(row.data(), top, rowBytes);
+            memcpy(top, bottom, rowBytes);
+            memcpy(bottom, row.data(), rowBytes);
+        }
+    }
+
+    char name[1024];
+    switch (m_format) {
+    case CaptureFormat::Raw: {
+        snprintf(name, sizeof(name), "%s%06d_%dx%d.rgba", m_path.c_str(), frame.index, frame.width, frame.height);
+        FILE* file = fopen(name, "wb");
+        if (file) {
+            fwrite(frame.pixels.data(), 1, frame.pixels.size(), file);
+            fclose(file);
+        }
+        break;
+    }
+    case CaptureFormat::Png: {
+        snprintf(name, sizeof(name), "%s%06d.png", m_path.c_str(), frame.index);
+        SkBitmap bitmap;
+        bitmap.installPixels(SkImageInfo::Make(frame.width, frame.height, kRGBA_8888_SkColorType, kPremul_SkAlphaType),
+            frame.pixels.data(), rowBytes);
+        if (!SkImageEncoder::EncodeFile(name, bitmap, SkImageEncoder::kPNG_Type, 100)) {
+            printf("Failed to write %s\n", name);
+        }
+        break;
+    }
+    case CaptureFormat::Y4m:
+        writeY4m(frame);
+        break;
+    }
+}
+
+void FrameCapture::writeY4m(const Frame& frame)
+{
+    if (!m_y4mWidth) {
+        m_y4mWidth = frame.width;
+        m_y4mHeight = frame.height;
+        // A measured rate is written as a fixed-width placeholder so stop()
+        // can overwrite it in place.
+        m_rateOffset = fprintf(m_y4m, "YUV4MPEG2 W%d H%d F", frame.width, frame.height);
+        if (m_frameRate > 0) {
+            fprintf(m_y4m, "%d", (int)(m_frameRate * 1000 + 0.5));
+        } else {
+            fprintf(m_y4m, "%010d", 60000);
+        }
+        fputs(":1000 Ip A1:1 C444\n", m_y4m);
+    } else if (frame.width != m_y4mWidth || frame.height != m_y4mHeight) {
+        printf("Skipping frame %d, size changed during Y4M capture\n", frame.index);
+        return;
+    }
+
+    // Full-range BT.601, one plane at a time.
+    size_t count = size_t(frame.width) * frame.height;
+    std::vector<uint8_t> plane(count);
+    const uint8_t* rgba = frame.pixels.data();
+    fputs("FRAME\n", m_y4m);
+    for (int p = 0; p < 3; ++p) {
+        for (size_t i = 0; i < count; ++i) {
+            float r = rgba[i * 4];
+            float g = rgba[i * 4 + 1];
+            float b = rgba[i * 4 + 2];
+            float v;
+            if (p == 0) {
+                v = 0.299f * r + 0.587f * g + 0.114f * b;
+            } else if (p == 1) {
+                v = 128 - 0.168736f * r - 0.331264f * g + 0.5f * b;
+            } else {
+                v = 128 + 0.5f * r - 0.418688f * g - 0.081312f * b;
+            }
+            plane[i] = (uint8_t)std::max(0.f, std::min(255.f, v + 0.5f));
+        }
+        fwrite(plane.data(), 1, count, m_y4m);
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SkSurface.h>
+#include <gl/GrGLTypes.h>
+
+enum class CaptureFormat
+{
+    Raw,
+    Png,
+    Y4m,
+};
+
+class FrameCapture
+{
+    struct Frame
+    {
+        std::vector<uint8_t> pixels;
+        int width;
+        int height;
+        int index;
+        bool bottomUp;
+    };
+
+    struct Slot
+    {
+        GrGLuint pbo;
+        void* fence;
+        int width;
+        int height;
+        int index;
+    };
+
+    static const int kSlots = 4;
+    static const int kMaxQueued = 16;
+
+    Slot m_slots[kSlots];
+    int m_next;
+    int m_frameIndex;
+    int m_dropped;
+
+    std::string m_path;
+    CaptureFormat m_format;
+    FILE* m_y4m;
+    double m_frameRate;
+    long m_rateOffset;
+    double m_firstTime;
+    double m_lastTime;
+    int m_y4mWidth;
+    int m_y4mHeight;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Frame> m_queue;
+    std::vector<std::vector<uint8_t>> m_freeBuffers;
+    bool m_stop;
+
+    std::vector<uint8_t> takeBuffer(size_t size);
+    void push(Frame&& frame);
+    bool collect(Slot& slot, bool wait);
+    void encodeLoop();
+    void encode(Frame& frame);
+    void writeY4m(const Frame& frame);
+
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    bool start(const std::string& path, CaptureFormat format);
+    bool capture(SkSurface* surface, GrGLuint framebuffer);
+    void stop();
+
+    // A rate of 0 measures it from the capture times and patches the Y4M
+    // header when the capture stops.
+    void setFrameRate(double fps) { m_frameRate = fps; }
+
+    bool isRunning() const { return m_thread.joinable(); }
+    int dropped() const { return m_dropped; }
+};
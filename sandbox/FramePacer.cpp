@@ -0,0 +1,56 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "Clock.h"
+
+FramePacer::FramePacer()
+    : m_refreshPeriod(1.0 / 60)
+    , m_frameStart(0)
+    , m_lastPresent(0)
+    , m_workTime(0)
+    , m_latency(0)
+    , m_averageLatency(0)
+    , m_latencySamples(0)
+{
+}
+
+void FramePacer::setRefreshRate(int hz)
+{
+    if (hz > 0) {
+        m_refreshPeriod = 1.0 / hz;
+    }
+}
+
+void FramePacer::wait()
+{
+    if (m_settings.framePacing && m_settings.swapInterval > 0 && m_lastPresent > 0) {
+        double deadline = m_lastPresent + m_refreshPeriod * m_settings.swapInterval;
+        double wakeup = deadline - m_workTime - m_settings.pacingSlack;
+        double now = clockSeconds();
+        if (wakeup > now) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(wakeup - now));
+        }
+    }
+    m_frameStart = clockSeconds();
+}
+
+void FramePacer::submitted()
+{
+    m_workTime = std::max(clockSeconds() - m_frameStart, m_workTime * 0.98);
+}
+
+void FramePacer::presented(double eventTime)
+{
+    double now = clockSeconds();
+    m_lastPresent = now;
+
+    if (!m_settings.measureLatency || eventTime <= 0) {
+        return;
+    }
+    m_latency = now - eventTime;
+    m_averageLatency = m_latencySamples ? m_averageLatency * 0.9 + m_latency * 0.1 : m_latency;
+    ++m_latencySamples;
+}
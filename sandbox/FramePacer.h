@@ -0,0 +1,49 @@
+#pragma once
+
+struct LatencySettings
+{
+    int swapInterval;
+    bool framePacing;
+    double pacingSlack;
+    bool lateLatch;
+    bool measureLatency;
+
+    LatencySettings()
+        : swapInterval(1)
+        , framePacing(false)
+        , pacingSlack(0.002)
+        , lateLatch(false)
+        , measureLatency(false)
+    {
+    }
+
+    bool waitsForPresent() const { return framePacing || measureLatency; }
+};
+
+class FramePacer
+{
+    LatencySettings m_settings;
+    double m_refreshPeriod;
+    double m_frameStart;
+    double m_lastPresent;
+    double m_workTime;
+    double m_latency;
+    double m_averageLatency;
+    int m_latencySamples;
+
+public:
+    FramePacer();
+
+    void setSettings(const LatencySettings& settings) { m_settings = settings; }
+    const LatencySettings& settings() const { return m_settings; }
+    void setRefreshRate(int hz);
+    double refreshPeriod() const { return m_refreshPeriod; }
+
+    void wait();
+    void submitted();
+    void presented(double eventTime);
+
+    double latency() const { return m_latency; }
+    double averageLatency() const { return m_averageLatency; }
+    int latencySamples() const { return m_latencySamples; }
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstring>
+
+struct FrameStats
+{
+    static const int kHistory = 120;
+
+    double frame;
+    double update;
+    double draw;
+    double flush;
+    double swap;
+    int ticks;
+    int viewsDrawn;
+    int viewsCulled;
+    int passes;
+    int flushes;
+    double latency;
+    double averageLatency;
+
+    double history[kHistory];
+    int historyIndex;
+    int historyCount;
+
+    FrameStats()
+    {
+        memset(this, 0, sizeof(*this));
+    }
+
+    void push(double frameTime)
+    {
+        frame = frameTime;
+        history[historyIndex] = frameTime;
+        historyIndex = (historyIndex + 1) % kHistory;
+        if (historyCount < kHistory) {
+            ++historyCount;
+        }
+    }
+
+    double averageFrameTime() const
+    {
+        double sum = 0;
+        for (int i = 0; i < historyCount; ++i) {
+            sum += history[i];
+        }
+        return historyCount ? sum / historyCount : 0;
+    }
+};
@@ -0,0 +1,184 @@
+#include "GlUtil.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <SkCodec.h>
+#include <SkData.h>
+
+GLuint getShader(const char* str, GLenum type, const char* defines)
+{
+    GLuint id = glCreateShader(type);
+    const char* sources[] = { defines ? defines : "", str };
+    glShaderSource(id, 2, sources, nullptr);
+    glCompileShader(id);
+    GLint res;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &res);
+    if (res == GL_FALSE) {
+        GLint len = 0;
+        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &len);
+        std::vector<GLchar> log(len);
+        glGetShaderInfoLog(id, len, &len, &log[0]);
+        printf("Shader log: [%s]\n", &log[0]);
+        glDeleteShader(id);
+        id = 0;
+    }
+    return id;
+}
+
+sk_sp<SkImage> loadImage(const std::string& path)
+{
+    sk_sp<SkData> encoded(SkData::MakeFromFileName(path.c_str()));
+    return SkImage::MakeFromEncoded(encoded);
+}
+
+bool loadScaledImage(const std::string& path, int maxSize, SkBitmap* bitmap, SkISize* fullSize)
+{
+    sk_sp<SkData> encoded(SkData::MakeFromFileName(path.c_str()));
+    if (!encoded) {
+        return false;
+    }
+    std::unique_ptr<SkCodec> codec(SkCodec::NewFromData(encoded));
+    if (!codec) {
+        return false;
+    }
+    SkISize size = codec->getInfo().dimensions();
+    if (fullSize) {
+        *fullSize = size;
+    }
+
+    // Codecs only support a few scale factors (JPEG decodes in eighths), so
+    // take the largest supported size that still fits in maxSize.
+    if (std::max(size.width(), size.height()) > maxSize) {
+        for (int eighths = 7; eighths >= 1; --eighths) {
+            size = codec->getScaledDimensions(eighths / 8.0f);
+            if (std::max(size.width(), size.height()) <= maxSize) {
+                break;
+            }
+        }
+    }
+
+    // Codecs that can't scale down far enough decode full size and are
+    // resampled to fit.
+    int largest = std::max(size.width(), size.height());
+    SkBitmap decoded;
+    SkBitmap* target = largest > maxSize ? &decoded : bitmap;
+    SkImageInfo info = SkImageInfo::MakeN32Premul(size.width(), size.height());
+    if (!target->tryAllocPixels(info)) {
+        return false;
+    }
+    SkCodec::Result result = codec->getPixels(info, target->getPixels(), target->rowBytes());
+    if (result != SkCodec::kSuccess && result != SkCodec::kIncompleteInput) {
+        return false;
+    }
+    if (target == bitmap) {
+        return true;
+    }
+    SkImageInfo fitted = info.makeWH(std::max(1, size.width() * maxSize / largest),
+        std::max(1, size.height() * maxSize / largest));
+    SkPixmap src;
+    SkPixmap dst;
+    return bitmap->tryAllocPixels(fitted) && decoded.peekPixels(&src) && bitmap->peekPixels(&dst) &&
+        src.scalePixels(dst, kMedium_SkFilterQuality);
+}
+
+// Decodes straight to the codec's native Y, U and V planes. Returns false when
+// the codec has no YUV path or the luma plane is larger than maxSize, since the
+// planes can't be decoded scaled.
+bool loadYUVPlanes(const std::string& path, int maxSize, YUVPlanes* yuv)
+{
+    sk_sp<SkData> encoded(SkData::MakeFromFileName(path.c_str()));
+    if (!encoded) {
+        return false;
+    }
+    std::unique_ptr<SkCodec> codec(SkCodec::NewFromData(encoded));
+    if (!codec || !codec->queryYUV8(&yuv->sizes, &yuv->colorSpace)) {
+        return false;
+    }
+    if (std::max(yuv->sizes.fSizes[0].width(), yuv->sizes.fSizes[0].height()) > maxSize) {
+        return false;
+    }
+    size_t total = 0;
+    for (int i = 0; i < 3; ++i) {
+        total += yuv->sizes.fWidthBytes[i] * yuv->sizes.fSizes[i].height();
+    }
+    yuv->storage.reset(new uint8_t[total]);
+    uint8_t* plane = yuv->storage.get();
+    for (int i = 0; i < 3; ++i) {
+        yuv->planes[i] = plane;
+        plane += yuv->sizes.fWidthBytes[i] * yuv->sizes.fSizes[i].height();
+    }
+    SkCodec::Result result = codec->getYUV8Planes(yuv->sizes, yuv->planes);
+    return result == SkCodec::kSuccess || result == SkCodec::kIncompleteInput;
+}
+
+void rotateXY(GLfloat mat[16], GLfloat x, GLfloat y)
+{
+    const GLfloat cosX = cosf(x);
+    const GLfloat sinX = sinf(x);
+    const GLfloat cosY = cosf(y);
+    const GLfloat sinY = sinf(y);
+    memset(mat, 0, sizeof(GLfloat) * 16);
+    mat[0] = cosY;
+    mat[2] = -sinY;
+
+    mat[4] = -sinX * sinY;
+    mat[5] = cosX;
+    mat[6] = -sinX * cosY;
+
+    mat[8] = cosX * sinY;
+    mat[9] = sinX;
+    mat[10] = cosX * cosY;
+
+    mat[15] = 1;
+}
+
+void perspectiveMatrixInverse(GLfloat mat[16], GLfloat fov, GLfloat aspect, GLfloat n, GLfloat f)
+{
+    GLfloat h = tanf(0.5f * fov);
+    GLfloat w = h * aspect;
+    GLfloat z0 = (f - n) / (-2 * f * n);
+    GLfloat z1 = (f + n) / (-2 * f * n);
+    memset(mat, 0, sizeof(GLfloat) * 16);
+    mat[0] = w;
+
+    mat[5] = h;
+
+    mat[11] = z0;
+
+    mat[14] = 1;
+    mat[15] = z1;
+}
+
+void multiply(GLfloat r[16], GLfloat a[16], GLfloat b[16])
+{
+    memset(r, 0, sizeof(GLfloat) * 16);
+    r[0] = a[0] * b[0] + a[1] * b[4] + a[2] * b[8] + a[3] * b[12];
+    r[1] = a[0] * b[1] + a[1] * b[5] + a[2] * b[9] + a[3] * b[13];
+    r[2] = a[0] * b[2] + a[1] * b[6] + a[2] * b[10] + a[3] * b[14];
+    r[3] = a[0] * b[3] + a[1] * b[7] + a[2] * b[11] + a[3] * b[15];
+
+    r[4] = a[4] * b[0] + a[5] * b[4] + a[6] * b[8] + a[7] * b[12];
+    r[5] = a[4] * b[1] + a[5] * b[5] + a[6] * b[9] + a[7] * b[13];
+    r[6] = a[4] * b[2] + a[5] * b[6] + a[6] * b[10] + a[7] * b[14];
+    r[7] = a[4] * b[3] + a[5] * b[7] + a[6] * b[11] + a[7] * b[15];
+
+    r[8] = a[8] * b[0] + a[9] * b[4] + a[10] * b[8] + a[11] * b[12];
+    r[9] = a[8] * b[1] + a[9] * b[5] + a[10] * b[9] + a[11] * b[13];
+    r[10] = a[8] * b[2] + a[9] * b[6] + a[10] * b[10] + a[11] * b[14];
+    r[11] = a[8] * b[3] + a[9] * b[7] + a[10] * b[11] + a[11] * b[15];
+
+    r[12] = a[12] * b[0] + a[13] * b[4] + a[14] * b[8] + a[15] * b[12];
+    r[13] = a[12] * b[1] + a[13] * b[5] + a[14] * b[9] + a[15] * b[13];
+    r[14] = a[12] * b[2] + a[13] * b[6] + a[14] * b[10] + a[15] * b[14];
+    r[15] = a[12] * b[3] + a[13] * b[7] + a[14] * b[11] + a[15] * b[15];
+}
+
+void checkGlError(const char* fn, int ln)
+{
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        printf("glGetError %s %d %x\n", fn, ln, err);
+    }
+}
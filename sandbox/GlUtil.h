@@ -0,0 +1,29 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <GL/glew.h>
+#include <SkBitmap.h>
+#include <SkImage.h>
+#include <SkYUVSizeInfo.h>
+
+struct YUVPlanes
+{
+    SkYUVSizeInfo sizes;
+    SkYUVColorSpace colorSpace;
+    std::unique_ptr<uint8_t[]> storage;
+    void* planes[3];
+};
+
+GLuint getShader(const char* str, GLenum type, const char* defines = nullptr);
+sk_sp<SkImage> loadImage(const std::string& path);
+bool loadScaledImage(const std::string& path, int maxSize, SkBitmap* bitmap, SkISize* fullSize = nullptr);
+bool loadYUVPlanes(const std::string& path, int maxSize, YUVPlanes* yuv);
+
+void rotateXY(GLfloat mat[16], GLfloat x, GLfloat y);
+void perspectiveMatrixInverse(GLfloat mat[16], GLfloat fov, GLfloat aspect, GLfloat n, GLfloat f);
+void multiply(GLfloat r[16], GLfloat a[16], GLfloat b[16]);
+
+void checkGlError(const char* fn, int ln);
+#define CHECK_ERROR() checkGlError(__FUNCTION__, __LINE__)
@@ -0,0 +1,577 @@
+#include "GlView.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <SkBitmap.h>
+#include <SkPaint.h>
+
+#include "Clock.h"
+#include "GlUtil.h"
+#include "GpuProfiler.h"
+
+#define SHADER_STR(s) #s
+
+static const char* vstxt = SHADER_STR(
+    attribute vec2 vPos; \n
+    uniform mat4 inv_mvp; \n
+    varying vec3 tex_coord; \n
+    void main() { \n
+        gl_Position = vec4(vPos, 0, 1); \n
+        tex_coord = (inv_mvp * gl_Position).xyz; \n
+    }
+);
+// The C preprocessor would swallow directives inside SHADER_STR, so this one
+// is spelled out as literals.
+static const char* fstxt =
+    "#ifdef GL_ES\n"
+    "precision highp float;\n"
+    "#endif\n"
+    "uniform samplerCube samp;\n"
+    "#ifdef YUV_PLANES\n"
+    "uniform samplerCube sampU;\n"
+    "uniform samplerCube sampV;\n"
+    "#endif\n"
+    "varying vec3 tex_coord;\n"
+    "void main() {\n"
+    "#ifdef YUV_PLANES\n"
+    // Full range BT.601, which is what JPEG stores.
+    "    float y = textureCube(samp, tex_coord).r;\n"
+    "    float u = textureCube(sampU, tex_coord).r - 0.5;\n"
+    "    float v = textureCube(sampV, tex_coord).r - 0.5;\n"
+    "    gl_FragColor = vec4(y + 1.402 * v, y - 0.344136 * u - 0.714136 * v, y + 1.772 * u, 1.0);\n"
+    "#else\n"
+    "    gl_FragColor = textureCube(samp, tex_coord);\n"
+    "#endif\n"
+    "}\n";
+
+// Hot reloads wait for writes to settle, since copying a set of faces or an
+// editor saving produces a burst of events.
+static const double kReloadDelay = 0.25;
+
+// Bytes of texture data uploaded per frame. A 2048 px RGBA cubemap with mips
+// is about 128 MB, so it streams in over roughly half a second at 60 Hz.
+static const size_t kUploadBudget = 4 << 20;
+
+static GLuint createCubeTexture()
+{
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+GlView::GlView(const std::string& path)
+    : m_program(0)
+    , m_posBuffer(0)
+    , m_inv_mvp(0)
+    , m_sampler(0)
+    , m_chromaSamplers()
+    , m_cubemap(0)
+    , m_chroma()
+    , m_yuv(false)
+    , m_programYuv(false)
+    , m_fov(1.5)
+    , m_angleX(0)
+    , m_angleY(0)
+    , m_alpha(255)
+    , m_prevFov(1.5)
+    , m_prevAlpha(255)
+    , m_drawFov(1.5)
+    , m_drawAlpha(255)
+    , m_drag(false)
+    , m_dragFrame(0)
+    , m_frameBudget(0)
+    , m_frameTime(0)
+    , m_lastDrawTime(0)
+    , m_renderScale(1)
+    , m_minRenderScale(0.5f)
+    , m_idleFrames(0)
+    , m_goodFrames(0)
+    , m_lastAngleX(0)
+    , m_lastAngleY(0)
+    , m_lastFov(0)
+    , m_maxTextureSize(0)
+    , m_faceSize(0)
+    , m_sourceFaceSize(0)
+    , m_loadFailed(false)
+    , m_uploadTextures()
+    , m_uploadProgram(0)
+    , m_uploadBuffer(0)
+    , m_uploadPlane(0)
+    , m_uploadFace(0)
+    , m_uploadLevel(0)
+    , m_uploadRow(0)
+    , m_changeTime(0)
+    , m_batch(nullptr)
+    , m_batchSlot(-1)
+    , m_passWidth(0)
+    , m_passHeight(0)
+    , m_passScheduled(false)
+    , m_path(path)
+{
+    setContentInBounds(true);
+}
+
+void GlView::deleteCubeMap()
+{
+    GLuint textures[] = { GLuint(m_cubemap), m_chroma[0], m_chroma[1] };
+    glDeleteTextures(3, textures);
+    m_cubemap = 0;
+    m_chroma[0] = m_chroma[1] = 0;
+}
+
+// Decodes happen in the background and uploads are streamed over several
+// frames into new textures, so neither the first load nor a reload stalls a
+// frame. The textures in use are only replaced once the new set is complete.
+void GlView::updateCubeMap(PassScheduler& scheduler)
+{
+    double now = clockSeconds();
+    if (m_watcher.poll()) {
+        m_changeTime = now;
+    }
+    if (m_upload) {
+        if (uploadStep()) {
+            swapCubeMap();
+        }
+        scheduler.invalidateState();
+        return;
+    }
+    if (m_loader.isPending()) {
+        std::unique_ptr<CubeMapData> data;
+        if (m_loader.poll(&data)) {
+            m_loadFailed = !data;
+            m_upload = std::move(data);
+        }
+        return;
+    }
+    int faceSize = requiredFaceSize();
+    bool changed = m_changeTime > 0 && now - m_changeTime > kReloadDelay;
+    bool grow = m_cubemap && faceSize > m_faceSize && m_faceSize < m_sourceFaceSize;
+    if (changed || (!m_loadFailed && (!m_cubemap || grow))) {
+        m_changeTime = 0;
+        m_loader.start(m_path, faceSize);
+    }
+}
+
+// Streams rows of every level, face and plane into the new textures through
+// a PBO, at most kUploadBudget bytes per call. Storage is allocated up front
+// and the mips come from the decoder, so no single frame pays for a whole face
+// or a glGenerateMipmap. Returns true once everything is in.
+bool GlView::uploadStep()
+{
+    const CubeMapData& data = *m_upload;
+    int planes = data.planeCount();
+    int bpp = data.bytesPerPixel();
+    if (!m_uploadTextures[0]) {
+        if (!m_program || m_programYuv != data.yuv) {
+            m_uploadProgram = getProgram(data.yuv);
+            if (!m_uploadProgram) {
+                printf("Failed to build the program for %s, keeping the current cubemap\n", m_path.c_str());
+                abortUpload();
+                return false;
+            }
+        }
+        for (int p = 0; p < planes; ++p) {
+            const std::vector<CubeMapLevel>& levels = data.levels[p][0];
+            m_uploadTextures[p] = createCubeTexture();
+            glTexStorage2D(GL_TEXTURE_CUBE_MAP, GLsizei(levels.size()), data.yuv ? GL_R8 : GL_RGBA8,
+                levels[0].size, levels[0].size);
+        }
+        if (!m_uploadBuffer) {
+            glGenBuffers(1, &m_uploadBuffer);
+        }
+        m_uploadPlane = 0;
+        m_uploadFace = 0;
+        m_uploadLevel = 0;
+        m_uploadRow = 0;
+    }
+
+    const GLenum format = data.yuv ? GL_RED : kN32_SkColorType == kBGRA_8888_SkColorType ? GL_BGRA : GL_RGBA;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uploadBuffer);
+    // Orphaning gives a fresh buffer instead of waiting on last frame's copies.
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, kUploadBudget, nullptr, GL_STREAM_DRAW);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    size_t offset = 0;
+    while (m_uploadPlane < planes) {
+        const std::vector<CubeMapLevel>& levels = data.levels[m_uploadPlane][m_uploadFace];
+        const CubeMapLevel& level = levels[m_uploadLevel];
+        size_t rowBytes = size_t(level.size) * bpp;
+        if (offset + rowBytes > kUploadBudget) {
+            break;
+        }
+        int rows = std::min(level.size - m_uploadRow, int((kUploadBudget - offset - rowBytes) / level.rowBytes) + 1);
+        size_t bytes = (rows - 1) * level.rowBytes + rowBytes;
+        glBufferSubData(GL_PIXEL_UNPACK_BUFFER, offset, bytes, level.pixels + m_uploadRow * level.rowBytes);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_uploadTextures[m_uploadPlane]);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, GLint(level.rowBytes / bpp));
+        glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + m_uploadFace, m_uploadLevel, 0, m_uploadRow,
+            level.size, rows, format, GL_UNSIGNED_BYTE, (const void*)offset);
+        offset = (offset + bytes + 3) & ~size_t(3);
+
+        m_uploadRow += rows;
+        if (m_uploadRow < level.size) {
+            continue;
+        }
+        m_uploadRow = 0;
+        if (++m_uploadLevel < (int)levels.size()) {
+            continue;
+        }
+        m_uploadLevel = 0;
+        if (++m_uploadFace < 6) {
+            continue;
+        }
+        m_uploadFace = 0;
+        ++m_uploadPlane;
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    CHECK_ERROR();
+    return m_uploadPlane == planes;
+}
+
+void GlView::abortUpload()
+{
+    glDeleteTextures(3, m_uploadTextures);
+    m_uploadTextures[0] = m_uploadTextures[1] = m_uploadTextures[2] = 0;
+    m_upload.reset();
+    m_loadFailed = true;
+}
+
+void GlView::swapCubeMap()
+{
+    deleteCubeMap();
+    m_cubemap = m_uploadTextures[0];
+    m_chroma[0] = m_uploadTextures[1];
+    m_chroma[1] = m_uploadTextures[2];
+    m_yuv = m_upload->yuv;
+    m_faceSize = m_upload->faceSize;
+    m_sourceFaceSize = m_upload->sourceFaceSize;
+    if (m_uploadProgram) {
+        setProgram(m_uploadProgram, m_yuv);
+        m_uploadProgram = 0;
+    }
+    m_upload.reset();
+    m_uploadTextures[0] = m_uploadTextures[1] = m_uploadTextures[2] = 0;
+}
+
+// Views sharing a batch render into one atlas in a single pass instead of
+// each into its own surface.
+void GlView::setBatch(CubeMapBatch* batch)
+{
+    m_batch = batch;
+    m_surface.reset();
+}
+
+void GlView::setHotReload(bool enabled)
+{
+    if (enabled) {
+        m_watcher.watch(m_path);
+    } else {
+        m_watcher.stop();
+    }
+}
+
+int GlView::requiredFaceSize()
+{
+    // A face spans [-1, 1] at unit distance, and the vertical fov maps
+    // tan(fov / 2) onto half the view height.
+    float pixels = std::max(width(), height()) / tanf(0.5f * m_drawFov);
+    int size = 64;
+    while (size < pixels && size < m_maxTextureSize) {
+        size *= 2;
+    }
+    return std::min(size, m_maxTextureSize);
+}
+
+GLuint GlView::getProgram(bool yuv)
+{
+    GLuint progId;
+    GLuint vId = getShader(vstxt, GL_VERTEX_SHADER);
+    GLuint fId = getShader(fstxt, GL_FRAGMENT_SHADER, yuv ? "#define YUV_PLANES\n" : nullptr);
+    if (vId && fId) {
+        progId = glCreateProgram();
+        glAttachShader(progId, vId);
+        glAttachShader(progId, fId);
+        glLinkProgram(progId);
+        glDeleteShader(vId);
+        glDeleteShader(fId);
+    } else {
+        glDeleteShader(vId);
+        glDeleteShader(fId);
+        return 0;
+    }
+    return progId;
+}
+
+void GlView::setProgram(GLuint program, bool yuv)
+{
+    glDeleteProgram(m_program);
+    m_program = program;
+    m_programYuv = yuv;
+    m_vPos = glGetAttribLocation(program, "vPos");
+    m_inv_mvp = glGetUniformLocation(program, "inv_mvp");
+    m_sampler = glGetUniformLocation(program, "samp");
+    m_chromaSamplers[0] = glGetUniformLocation(program, "sampU");
+    m_chromaSamplers[1] = glGetUniformLocation(program, "sampV");
+
+    if (!m_posBuffer) {
+        glCreateBuffers(1, &m_posBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_posBuffer);
+
+        GLfloat verts[] = { -1, -1,  3, -1,  -1, 3 };
+        glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+    }
+}
+
+void GlView::onSchedulePasses(PassScheduler& scheduler)
+{
+    GrContext* context = scheduler.context();
+    if (!context) {
+        return;
+    }
+    if (!m_maxTextureSize) {
+        glGetIntegerv(GL_MAX_CUBE_MAP_TEXTURE_SIZE, &m_maxTextureSize);
+    }
+    updateCubeMap(scheduler);
+    if (!m_cubemap || !m_program) {
+        return;
+    }
+    updateRenderScale();
+    m_passWidth = std::max(1, SkScalarRoundToInt(drawWidth() * m_renderScale));
+    m_passHeight = std::max(1, SkScalarRoundToInt(drawHeight() * m_renderScale));
+
+    if (GpuProfiler::current() && (m_passScope.empty() || m_scopeName != name())) {
+        m_scopeName = name();
+        std::string label = m_scopeName.empty() ? "GlView" : m_scopeName;
+        m_passScope = label + " pass";
+        m_compositeScope = label + " composite";
+    }
+
+    if (m_batch) {
+        CubeMapDraw draw;
+        draw.textures[0] = m_cubemap;
+        draw.textures[1] = m_chroma[0];
+        draw.textures[2] = m_chroma[1];
+        draw.yuv = m_yuv;
+        viewMatrix(draw.inv_mvp);
+        draw.width = m_passWidth;
+        draw.height = m_passHeight;
+        m_batchSlot = m_batch->add(scheduler, draw);
+        if (m_batchSlot >= 0) {
+            m_surface.reset();
+            m_passScheduled = true;
+            return;
+        }
+        // The atlas couldn't fit this view, so it renders on its own.
+    }
+
+    if (!m_surface || m_surface->width() != drawWidthI() || m_surface->height() != drawHeightI()) {
+        m_surface = SkSurface::MakeRenderTarget(context, SkBudgeted::kYes, SkImageInfo::MakeN32Premul(drawWidthI(), drawHeightI()));
+        if (!m_surface) {
+            return;
+        }
+        GrBackendObject obj;
+        m_surface->getRenderTargetHandle(&obj, SkSurface::BackendHandleAccess::kFlushWrite_BackendHandleAccess);
+        m_fb = obj;
+    }
+    scheduler.add(m_passScope, [this] { renderPass(m_passWidth, m_passHeight); });
+    m_passScheduled = true;
+}
+
+void GlView::onDraw(SkCanvas& canvas)
+{
+    if (!m_passScheduled) {
+        return;
+    }
+    m_passScheduled = false;
+    // Flush work queued by earlier views first so it isn't timed as part of
+    // this composite.
+    bool profiling = GpuProfiler::current() != nullptr;
+    if (profiling) {
+        flush(canvas);
+    }
+    GPU_SCOPE(m_compositeScope);
+    composite(canvas, m_passWidth, m_passHeight);
+    if (profiling) {
+        flush(canvas);
+    }
+}
+
+void GlView::renderPass(int w, int h)
+{
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fb);
+    glViewport(0, 0, w, h);
+
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glUseProgram(m_program);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_posBuffer);
+    glEnableVertexAttribArray(m_vPos);
+    glVertexAttribPointer(m_vPos, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+    if (m_yuv) {
+        for (int i = 0; i < 2; ++i) {
+            glActiveTexture(GL_TEXTURE1 + i);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, m_chroma[i]);
+            glUniform1i(m_chromaSamplers[i], 1 + i);
+        }
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemap);
+
+    GLfloat mat[16];
+    viewMatrix(mat);
+    glUniformMatrix4fv(m_inv_mvp, 1, false, mat);
+    glUniform1i(m_sampler, 0);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void GlView::viewMatrix(GLfloat mat[16])
+{
+    GLfloat v[16];
+    GLfloat p[16];
+    rotateXY(v, m_angleX, m_angleY);
+    perspectiveMatrixInverse(p, m_drawFov, drawWidth() / drawHeight(), 0.01f, 100.0f);
+    multiply(mat, p, v);
+}
+
+void GlView::composite(SkCanvas& canvas, int w, int h)
+{
+    SkPaint paint;
+    paint.setAlpha(SkScalarRoundToInt(m_drawAlpha));
+    if (m_batch && m_batchSlot >= 0) {
+        paint.setFilterQuality(kLow_SkFilterQuality);
+        m_batch->composite(canvas, m_batchSlot, drawRect(), paint);
+        return;
+    }
+    if (w == drawWidthI() && h == drawHeightI()) {
+        m_surface->draw(&canvas, 0, 0, &paint);
+        return;
+    }
+    // The surface has a bottom-left origin, so the GL viewport at (0, 0) is
+    // the bottom rows of the snapshot. Texels outside it are stale, so the
+    // filter must not reach past src.
+    paint.setFilterQuality(kLow_SkFilterQuality);
+    sk_sp<SkImage> image(m_surface->makeImageSnapshot());
+    SkRect src = SkRect::MakeXYWH(0, SkIntToScalar(m_surface->height() - h), SkIntToScalar(w), SkIntToScalar(h));
+    canvas.drawImageRect(image, src, drawRect(), &paint, SkCanvas::kStrict_SrcRectConstraint);
+}
+
+void GlView::updateRenderScale()
+{
+    double now = clockSeconds();
+    if (m_lastDrawTime > 0) {
+        double dt = now - m_lastDrawTime;
+        m_frameTime = m_frameTime > 0 ? m_frameTime * 0.8 + dt * 0.2 : dt;
+    }
+    m_lastDrawTime = now;
+
+    bool idle = m_angleX == m_lastAngleX && m_angleY == m_lastAngleY && m_fov == m_lastFov;
+    m_lastAngleX = m_angleX;
+    m_lastAngleY = m_angleY;
+    m_lastFov = m_fov;
+    m_idleFrames = idle ? m_idleFrames + 1 : 0;
+
+    if (m_frameBudget <= 0 || m_idleFrames > 10) {
+        m_renderScale = 1;
+        m_goodFrames = 0;
+    } else if (m_frameTime > m_frameBudget) {
+        m_renderScale = std::max(m_minRenderScale, m_renderScale * 0.85f);
+        m_goodFrames = 0;
+    } else if (++m_goodFrames > 30) {
+        m_renderScale = std::min(1.f, m_renderScale * 1.05f);
+    }
+}
+
+void GlView::setFrameBudget(double seconds, SkScalar minScale)
+{
+    m_frameBudget = seconds;
+    m_minRenderScale = std::max(std::min(minScale, 1.f), 0.1f);
+}
+
+void GlView::rotateTo(SkPoint cursor)
+{
+    m_angleX += (cursor.y() - m_dragCursor.y()) * 0.006f;
+    m_angleY -= (cursor.x() - m_dragCursor.x()) * 0.006f;
+    m_angleX = std::max(std::min(m_angleX, 3.1415f / 2), -3.1415f / 2);
+    m_dragCursor = cursor;
+}
+
+void GlView::onTick(double dt)
+{
+    m_prevFov = m_fov;
+    m_prevAlpha = m_alpha;
+}
+
+void GlView::onInterpolate(SkScalar alpha)
+{
+    m_drawFov = m_prevFov + (m_fov - m_prevFov) * alpha;
+    m_drawAlpha = m_prevAlpha + (m_alpha - m_prevAlpha) * alpha;
+}
+
+bool GlView::onUpdate(const InputState& state)
+{
+    bool consumed = false;
+    if (state.isKeyDown(GLFW_KEY_W)) {
+        m_fov *= std::expf(-0.3f);
+        consumed = true;
+    }
+    else if (state.isKeyDown(GLFW_KEY_S)) {
+        m_fov *= std::expf(0.3f);
+        consumed = true;
+    }
+    if (state.isKeyDown(GLFW_KEY_A)) {
+        m_alpha -= 2;
+        consumed = true;
+    } else if (state.isKeyDown(GLFW_KEY_D)) {
+        m_alpha += 2;
+        consumed = true;
+    }
+    m_alpha = std::max(std::min(m_alpha, 255.f), 0.f);
+    m_fov = std::max(std::min(m_fov, 2.1f), 0.1f);
+    if (!state.isButtonDown(GLFW_MOUSE_BUTTON_LEFT)) {
+        m_drag = false;
+        return consumed;
+    } else if (state.isKeyDown(GLFW_KEY_LEFT_CONTROL)) {
+        m_drag = false;
+        return false;
+    }
+    // A drag continued from the previous frame resumes from the cursor that was
+    // last applied, which may be a late-latched one newer than getPreviousCursor.
+    if (!m_drag || m_dragFrame + 1 != state.frame()) {
+        m_dragCursor = state.getPreviousCursor();
+    }
+    m_drag = true;
+    m_dragFrame = state.frame();
+    rotateTo(state.getCursor());
+    return true;
+}
+
+void GlView::onLatch(const InputState& state)
+{
+    if (m_drag && m_dragFrame + 1 == state.frame() && state.isButtonDown(GLFW_MOUSE_BUTTON_LEFT)) {
+        rotateTo(state.getCursor());
+    }
+}
+
+void GlView::onExit()
+{
+    m_surface.reset();
+    m_loader.cancel();
+    m_upload.reset();
+    glDeleteTextures(3, m_uploadTextures);
+    glDeleteProgram(m_uploadProgram);
+    glDeleteBuffers(1, &m_uploadBuffer);
+    deleteCubeMap();
+    glDeleteProgram(m_program);
+    glDeleteBuffers(1, &m_posBuffer);
+}
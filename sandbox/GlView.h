@@ -0,0 +1,111 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <GL/glew.h>
+#include <SkSurface.h>
+
+#include "CubeMapBatch.h"
+#include "CubeMapLoader.h"
+#include "FileWatcher.h"
+#include "View.h"
+
+class GlView : public View
+{
+    GLuint m_program;
+    GLuint m_posBuffer;
+
+    GLint m_inv_mvp;
+    GLint m_sampler;
+    GLint m_chromaSamplers[2];
+    GLint m_cubemap;
+    GLuint m_chroma[2];
+    bool m_yuv;
+    bool m_programYuv;
+    GLint m_vPos;
+
+    sk_sp<SkSurface> m_surface;
+    GLuint m_fb;
+
+    GLfloat m_fov;
+    GLfloat m_angleX;
+    GLfloat m_angleY;
+    SkScalar m_alpha;
+    GLfloat m_prevFov;
+    SkScalar m_prevAlpha;
+    GLfloat m_drawFov;
+    SkScalar m_drawAlpha;
+    bool m_drag;
+    unsigned m_dragFrame;
+    SkPoint m_dragCursor;
+
+    double m_frameBudget;
+    double m_frameTime;
+    double m_lastDrawTime;
+    SkScalar m_renderScale;
+    SkScalar m_minRenderScale;
+    int m_idleFrames;
+    int m_goodFrames;
+    GLfloat m_lastAngleX;
+    GLfloat m_lastAngleY;
+    GLfloat m_lastFov;
+
+    GLint m_maxTextureSize;
+    int m_faceSize;
+    int m_sourceFaceSize;
+    CubeMapLoader m_loader;
+    bool m_loadFailed;
+    std::unique_ptr<CubeMapData> m_upload;
+    GLuint m_uploadTextures[3];
+    GLuint m_uploadProgram;
+    GLuint m_uploadBuffer;
+    int m_uploadPlane;
+    int m_uploadFace;
+    int m_uploadLevel;
+    int m_uploadRow;
+    FileWatcher m_watcher;
+    double m_changeTime;
+    CubeMapBatch* m_batch;
+    int m_batchSlot;
+    int m_passWidth;
+    int m_passHeight;
+    bool m_passScheduled;
+
+    std::string m_scopeName;
+    std::string m_passScope;
+    std::string m_compositeScope;
+
+    std::string m_path;
+
+    void deleteCubeMap();
+    void updateCubeMap(PassScheduler& scheduler);
+    bool uploadStep();
+    void swapCubeMap();
+    void abortUpload();
+    int requiredFaceSize();
+    GLuint getProgram(bool yuv);
+    void setProgram(GLuint program, bool yuv);
+    void rotateTo(SkPoint cursor);
+    void updateRenderScale();
+    void viewMatrix(GLfloat mat[16]);
+    void renderPass(int w, int h);
+    void composite(SkCanvas& canvas, int w, int h);
+
+    void onSchedulePasses(PassScheduler& scheduler) override;
+    void onDraw(SkCanvas& canvas) override;
+    bool onUpdate(const InputState& state) override;
+    void onLatch(const InputState& state) override;
+    void onTick(double dt) override;
+    void onInterpolate(SkScalar alpha) override;
+    void onExit() override;
+
+public:
+    GlView(const std::string& path);
+
+    const std::string& path() const { return m_path; }
+    void setFrameBudget(double seconds, SkScalar minScale = 0.5f);
+    void setHotReload(bool enabled);
+    void setBatch(CubeMapBatch* batch);
+    SkScalar renderScale() const { return m_renderScale; }
+};
@@ -0,0 +1,117 @@
+#include <GL/glew.h>
+#include "GpuProfiler.h"
+
+#include <cstdio>
+
+GpuProfiler* GpuProfiler::s_current = nullptr;
+
+GpuProfiler::GpuProfiler()
+    : m_frame(0)
+    , m_supported(true)
+{
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    if (s_current == this) {
+        s_current = nullptr;
+    }
+}
+
+GrGLuint GpuProfiler::query()
+{
+    GLuint id = 0;
+    if (m_freeQueries.empty()) {
+        glGenQueries(1, &id);
+    } else {
+        id = m_freeQueries.back();
+        m_freeQueries.pop_back();
+    }
+    return id;
+}
+
+void GpuProfiler::begin(const std::string& name)
+{
+    if (m_supported && !(GLEW_ARB_timer_query || GLEW_VERSION_3_3)) {
+        printf("GPU profiling needs GL_ARB_timer_query\n");
+        m_supported = false;
+    }
+    if (!m_supported) {
+        return;
+    }
+    auto it = m_timingIndex.find(name);
+    if (it == m_timingIndex.end()) {
+        it = m_timingIndex.emplace(name, (int)m_timings.size()).first;
+        m_timings.push_back({ name, 0, 0, 0 });
+    }
+    Sample sample = { it->second, query(), 0 };
+    glQueryCounter(sample.begin, GL_TIMESTAMP);
+    m_open.push_back(sample);
+}
+
+void GpuProfiler::end()
+{
+    if (m_open.empty()) {
+        return;
+    }
+    Sample sample = m_open.back();
+    m_open.pop_back();
+    sample.end = query();
+    glQueryCounter(sample.end, GL_TIMESTAMP);
+    m_frames[m_frame % kFrameLatency].push_back(sample);
+}
+
+void GpuProfiler::endFrame()
+{
+    ++m_frame;
+    // The slot about to be reused was issued kFrameLatency frames ago, which is
+    // normally long enough for its queries to be available without a stall.
+    resolve(m_frames[m_frame % kFrameLatency]);
+}
+
+void GpuProfiler::resolve(std::vector<Sample>& samples)
+{
+    for (const Sample& s : samples) {
+        GLint available = 0;
+        glGetQueryObjectiv(s.end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 begin = 0;
+            GLuint64 end = 0;
+            glGetQueryObjectui64v(s.begin, GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(s.end, GL_QUERY_RESULT, &end);
+            GpuTiming& t = m_timings[s.timing];
+            t.last = (end - begin) / 1e6;
+            t.average = t.samples ? t.average * 0.95 + t.last * 0.05 : t.last;
+            ++t.samples;
+        }
+        m_freeQueries.push_back(s.begin);
+        m_freeQueries.push_back(s.end);
+    }
+    samples.clear();
+}
+
+void GpuProfiler::release()
+{
+    for (std::vector<Sample>& samples : m_frames) {
+        for (const Sample& s : samples) {
+            m_freeQueries.push_back(s.begin);
+            m_freeQueries.push_back(s.end);
+        }
+        samples.clear();
+    }
+    for (const Sample& s : m_open) {
+        m_freeQueries.push_back(s.begin);
+    }
+    m_open.clear();
+    if (!m_freeQueries.empty()) {
+        glDeleteQueries((GLsizei)m_freeQueries.size(), m_freeQueries.data());
+    }
+    m_freeQueries.clear();
+}
+
+void GpuProfiler::print() const
+{
+    for (const GpuTiming& t : m_timings) {
+        printf("GPU %-24s %6.3f ms (avg %6.3f ms)\n", t.name.c_str(), t.last, t.average);
+    }
+}
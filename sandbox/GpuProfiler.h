@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <SkTypes.h>
+#include <gl/GrGLTypes.h>
+
+struct GpuTiming
+{
+    std::string name;
+    double last;
+    double average;
+    int samples;
+};
+
+class GpuProfiler
+{
+    struct Sample
+    {
+        int timing;
+        GrGLuint begin;
+        GrGLuint end;
+    };
+
+    static const int kFrameLatency = 4;
+    static GpuProfiler* s_current;
+
+    std::vector<GpuTiming> m_timings;
+    std::unordered_map<std::string, int> m_timingIndex;
+    std::vector<Sample> m_frames[kFrameLatency];
+    std::vector<Sample> m_open;
+    std::vector<GrGLuint> m_freeQueries;
+    int m_frame;
+    bool m_supported;
+
+    GrGLuint query();
+    void resolve(std::vector<Sample>& samples);
+
+public:
+    GpuProfiler();
+    ~GpuProfiler();
+
+    static GpuProfiler* current() { return s_current; }
+    static void setCurrent(GpuProfiler* profiler) { s_current = profiler; }
+
+    void begin(const std::string& name);
+    void end();
+    void endFrame();
+    void release();
+    void print() const;
+
+    const std::vector<GpuTiming>& timings() const { return m_timings; }
+};
+
+class GpuScope
+{
+    GpuProfiler* m_profiler;
+
+public:
+    GpuScope(const std::string& name)
+        : m_profiler(GpuProfiler::current())
+    {
+        if (m_profiler) {
+            m_profiler->begin(name);
+        }
+    }
+    ~GpuScope()
+    {
+        if (m_profiler) {
+            m_profiler->end();
+        }
+    }
+};
+
+#define GPU_SCOPE(name) GpuScope SK_MACRO_APPEND_LINE(gpu_scope)(name)
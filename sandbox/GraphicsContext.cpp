@@ -1,5 +1,7 @@
 #include "GraphicsContext.h"
 
+#include <cstdio>
+
 GraphicsContext::GraphicsContext()
 {
 }
@@ -8,10 +10,21 @@ GraphicsContext::~GraphicsContext()
 {
 }
 
-void GraphicsContext::init()
+// Takes over the ref on glinterface, or uses the platform's native interface
+// when it is null.
+bool GraphicsContext::init(const GrGLInterface* glinterface)
 {
-    SkAutoTUnref<const GrGLInterface> glinterface(GrGLCreateNativeInterface());
-    m_grctx.reset(GrContext::Create(GrBackend::kOpenGL_GrBackend, (GrBackendContext)glinterface.get()));
+    SkAutoTUnref<const GrGLInterface> iface(glinterface ? glinterface : GrGLCreateNativeInterface());
+    if (!iface) {
+        printf("Failed to create the Skia GL interface\n");
+        return false;
+    }
+    m_grctx.reset(GrContext::Create(GrBackend::kOpenGL_GrBackend, (GrBackendContext)iface.get()));
+    if (!m_grctx) {
+        printf("Failed to create GrContext\n");
+        return false;
+    }
+    return true;
 }
 
 void GraphicsContext::reset()
@@ -19,13 +32,21 @@ void GraphicsContext::reset()
     m_grctx.reset();
 }
 
-RenderTarget GraphicsContext::createDefaultTarget(int width, int height, int stencilBits)
+void GraphicsContext::resetState()
+{
+    if (m_grctx) {
+        m_grctx->resetContext();
+    }
+}
+
+RenderTarget GraphicsContext::createDefaultTarget(int width, int height, int stencilBits, GrGLuint framebuffer)
 {
     GrBackendRenderTargetDesc desc;
     desc.fWidth = width;
     desc.fHeight = height;
     desc.fConfig = GrPixelConfig::kRGBA_8888_GrPixelConfig;
     desc.fStencilBits = stencilBits;
+    desc.fRenderTargetHandle = framebuffer;
     return RenderTarget(SkSurface::MakeFromBackendRenderTarget(m_grctx.get(), desc, nullptr));
 }
 
@@ -12,10 +12,11 @@ public:
     GraphicsContext();
     ~GraphicsContext();
 
-    void init();
+    bool init(const GrGLInterface* glinterface = nullptr);
     void reset();
+    void resetState();
 
-    RenderTarget createDefaultTarget(int width, int height, int stencilBits);
+    RenderTarget createDefaultTarget(int width, int height, int stencilBits, GrGLuint framebuffer = 0);
     RenderTarget createRenderTarget(int width, int height);
 };
 
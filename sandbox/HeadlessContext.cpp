@@ -0,0 +1,180 @@
+#include <GL/glew.h>
+#include "HeadlessContext.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <gl/GrGLAssembleInterface.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+HeadlessContext::HeadlessContext()
+    : m_display(nullptr)
+    , m_context(nullptr)
+    , m_fb(0)
+    , m_color(0)
+    , m_depthStencil(0)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    reset();
+}
+
+#ifdef __linux__
+
+static EGLDisplay getDisplay()
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    return display;
+}
+
+bool HeadlessContext::init()
+{
+    EGLDisplay display = getDisplay();
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        printf("Failed to initialize EGL display\n");
+        return false;
+    }
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context")) {
+        printf("EGL_KHR_surfaceless_context is not supported\n");
+        eglTerminate(display);
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        printf("eglBindAPI(EGL_OPENGL_API) failed\n");
+        eglTerminate(display);
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint count = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &count) || count == 0) {
+        printf("eglChooseConfig found no OpenGL config\n");
+        eglTerminate(display);
+        return false;
+    }
+
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+    if (context == EGL_NO_CONTEXT) {
+        printf("eglCreateContext error: %x\n", eglGetError());
+        eglTerminate(display);
+        return false;
+    }
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        printf("eglMakeCurrent error: %x\n", eglGetError());
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+
+    m_display = display;
+    m_context = context;
+    printf("EGL %d.%d %s\n", major, minor, eglQueryString(display, EGL_VENDOR));
+    return true;
+}
+
+static GrGLFuncPtr getEglProc(void* ctx, const char name[])
+{
+    return (GrGLFuncPtr)eglGetProcAddress(name);
+}
+
+const GrGLInterface* HeadlessContext::createInterface()
+{
+    if (!m_context) {
+        return nullptr;
+    }
+    return GrGLAssembleInterface(nullptr, getEglProc);
+}
+
+void HeadlessContext::reset()
+{
+    if (!m_display) {
+        return;
+    }
+    releaseFramebuffer();
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(m_display, m_context);
+    eglTerminate(m_display);
+    m_context = nullptr;
+    m_display = nullptr;
+}
+
+#else
+
+bool HeadlessContext::init()
+{
+    printf("Headless rendering is not supported on this platform\n");
+    return false;
+}
+
+void HeadlessContext::reset()
+{
+}
+
+const GrGLInterface* HeadlessContext::createInterface()
+{
+    return nullptr;
+}
+
+#endif
+
+bool HeadlessContext::resize(int width, int height)
+{
+    releaseFramebuffer();
+
+    glGenRenderbuffers(1, &m_color);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &m_depthStencil);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+    glGenFramebuffers(1, &m_fb);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fb);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencil);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Headless framebuffer incomplete: %x\n", status);
+        releaseFramebuffer();
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::releaseFramebuffer()
+{
+    if (m_fb) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &m_fb);
+        glDeleteRenderbuffers(1, &m_color);
+        glDeleteRenderbuffers(1, &m_depthStencil);
+    }
+    m_fb = 0;
+    m_color = 0;
+    m_depthStencil = 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <gl/GrGLTypes.h>
+
+struct GrGLInterface;
+
+class HeadlessContext
+{
+    void* m_display;
+    void* m_context;
+
+    GrGLuint m_fb;
+    GrGLuint m_color;
+    GrGLuint m_depthStencil;
+
+    void releaseFramebuffer();
+
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    bool init();
+    bool resize(int width, int height);
+    void reset();
+
+    // Skia's native interface is GLX based on Linux, so the headless context
+    // resolves GL entry points through EGL instead. The caller owns the ref.
+    const GrGLInterface* createInterface();
+
+    GrGLuint framebuffer() const { return m_fb; }
+};
@@ -1,6 +1,10 @@
 #include "InputState.h"
 
+#include "Clock.h"
+
 InputState::InputState()
+    : m_frame(0)
+    , m_eventTime(0)
 {
     memset(m_keys, 0, sizeof(m_keys));
     memset(m_mouse, 0, sizeof(m_mouse));
@@ -13,12 +17,14 @@ InputState::~InputState()
 void InputState::setCursor(double x, double y)
 {
     m_cursor.set(SkDoubleToScalar(x), SkDoubleToScalar(y));
+    touch();
 }
 
 void InputState::setKey(int key, int action)
 {
     if (key < GLFW_KEY_LAST) {
         m_keys[key] = action;
+        touch();
     }
 }
 
@@ -26,12 +32,26 @@ void InputState::setButton(int button, int action)
 {
     if (button < GLFW_MOUSE_BUTTON_LAST) {
         m_mouse[button] = action;
+        touch();
+    }
+}
+
+void InputState::touch()
+{
+    if (m_eventTime == 0) {
+        m_eventTime = clockSeconds();
     }
 }
 
 void InputState::poll()
 {
+    ++m_frame;
     m_prevCursor = m_cursor;
+    for (int i = 0; i < GLFW_KEY_LAST; ++i) {
+        if (m_keys[i] == GLFW_PRESS) {
+            m_keys[i] = GLFW_REPEAT;
+        }
+    }
     for (int i = 0; i < GLFW_MOUSE_BUTTON_LAST; ++i) {
         if (m_mouse[i] == GLFW_PRESS) {
             m_mouse[i] = GLFW_REPEAT;
@@ -9,6 +9,10 @@ class InputState
     char m_mouse[GLFW_MOUSE_BUTTON_LAST];
     SkPoint m_cursor;
     SkPoint m_prevCursor;
+    unsigned m_frame;
+    double m_eventTime;
+
+    void touch();
 
 public:
     InputState();
@@ -17,13 +21,18 @@ public:
     void setCursor(double x, double y);
     void setKey(int key, int action);
     void setButton(int button, int action);
+    // Ends an update: ages presses to repeats and clears the cursor delta.
     void poll();
 
+    // Pressed is true only until the next poll, then the key reads as down.
     bool isKeyPressed(int key) const;
     bool isKeyDown(int key) const;
     bool isButtonPressed(int button) const;
     bool isButtonDown(int button) const;
     SkPoint getCursor() const;
     SkPoint getPreviousCursor() const;
+    unsigned frame() const { return m_frame; }
+    double eventTime() const { return m_eventTime; }
+    void clearEventTime() { m_eventTime = 0; }
 };
 
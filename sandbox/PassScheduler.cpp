@@ -0,0 +1,50 @@
+#include "PassScheduler.h"
+
+#include "GpuProfiler.h"
+
+PassScheduler::PassScheduler()
+    : m_context(nullptr)
+    , m_count(0)
+    , m_frame(0)
+{
+}
+
+void PassScheduler::begin(GrContext* context)
+{
+    m_context = context;
+    m_count = 0;
+    ++m_frame;
+}
+
+void PassScheduler::add(const std::string& name, std::function<void()> pass)
+{
+    // Slots are reused across frames so steady state doesn't allocate.
+    if (m_count == (int)m_passes.size()) {
+        m_passes.emplace_back();
+    }
+    Pass& slot = m_passes[m_count++];
+    slot.name = name;
+    slot.run = std::move(pass);
+}
+
+void PassScheduler::invalidateState()
+{
+    if (m_context) {
+        m_context->resetContext();
+    }
+}
+
+void PassScheduler::run()
+{
+    if (!m_count) {
+        return;
+    }
+    for (int i = 0; i < m_count; ++i) {
+        GPU_SCOPE(m_passes[i].name);
+        m_passes[i].run();
+        m_passes[i].run = nullptr;
+    }
+    if (m_context) {
+        m_context->resetContext();
+    }
+}
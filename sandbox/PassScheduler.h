@@ -0,0 +1,37 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <GrContext.h>
+
+// Collects the offscreen GL passes of a frame so they run back to back before
+// Skia records the main canvas, followed by a single resetContext.
+class PassScheduler
+{
+    struct Pass
+    {
+        std::string name;
+        std::function<void()> run;
+    };
+
+    GrContext* m_context;
+    std::vector<Pass> m_passes;
+    int m_count;
+    unsigned m_frame;
+
+public:
+    PassScheduler();
+
+    void begin(GrContext* context);
+    void add(const std::string& name, std::function<void()> pass);
+    // Call after GL work done outside a pass, such as uploads, so Skia calls
+    // made while scheduling see the right state.
+    void invalidateState();
+    void run();
+
+    GrContext* context() const { return m_context; }
+    int passCount() const { return m_count; }
+    unsigned frame() const { return m_frame; }
+};
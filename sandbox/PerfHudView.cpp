@@ -0,0 +1,128 @@
+#include "PerfHudView.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <GrContext.h>
+
+static const SkScalar kPanelWidth = 260;
+static const SkScalar kGraphHeight = 60;
+static const SkScalar kLineHeight = 14;
+static const double kGraphScale = 1.0 / 50;
+
+PerfHudView::PerfHudView(const FrameStats& stats, int toggleKey)
+    : m_stats(stats)
+    , m_profiler(nullptr)
+    , m_toggleKey(toggleKey)
+    , m_visible(true)
+{
+    m_background.setColor(SkColorSetARGB(180, 0, 0, 0));
+    m_text.setAntiAlias(true);
+    m_text.setColor(SK_ColorWHITE);
+    m_text.setTextSize(12);
+    m_graph.setAntiAlias(true);
+    m_graph.setColor(SK_ColorGREEN);
+    m_graph.setStyle(SkPaint::kStroke_Style);
+    m_budget.setColor(SkColorSetARGB(120, 255, 255, 0));
+    m_bars[0].setColor(SkColorSetRGB(80, 160, 255));
+    m_bars[1].setColor(SkColorSetRGB(255, 160, 60));
+    m_bars[2].setColor(SkColorSetRGB(220, 80, 200));
+    m_bars[3].setColor(SkColorSetRGB(120, 220, 120));
+}
+
+void PerfHudView::drawLine(SkCanvas& canvas, SkScalar y, int len)
+{
+    len = std::max(0, std::min(len, (int)sizeof(m_line) - 1));
+    canvas.drawText(m_line, len, 8, y, m_text);
+}
+
+void PerfHudView::onDraw(SkCanvas& canvas)
+{
+    if (!m_visible) {
+        return;
+    }
+    int lines = m_stats.latency > 0 ? 6 : 5;
+    if (m_profiler) {
+        lines += (int)m_profiler->timings().size();
+    }
+    SkScalar panelHeight = kGraphHeight + 16 + 8 + lines * kLineHeight;
+    canvas.drawRect(SkRect::MakeWH(kPanelWidth, panelHeight), m_background);
+
+    double average = m_stats.averageFrameTime();
+    SkScalar y = kLineHeight;
+    drawLine(canvas, y, snprintf(m_line, sizeof(m_line), "%.1f fps  %.2f ms  (avg %.2f ms)",
+        average > 0 ? 1 / average : 0.0, m_stats.frame * 1000, average * 1000));
+
+    // Frame time graph, oldest sample on the left, with a line at 60 Hz.
+    SkScalar graphTop = y + 6;
+    SkScalar graphBottom = graphTop + kGraphHeight;
+    SkScalar step = (kPanelWidth - 16) / (FrameStats::kHistory - 1);
+    SkScalar budgetY = graphBottom - SkDoubleToScalar(kGraphHeight * (1.0 / 60) / kGraphScale);
+    canvas.drawRect(SkRect::MakeLTRB(8, budgetY, kPanelWidth - 8, budgetY + 1), m_budget);
+    int count = m_stats.historyCount;
+    int first = (m_stats.historyIndex - count + FrameStats::kHistory) % FrameStats::kHistory;
+    for (int i = 0; i < count; ++i) {
+        double t = std::min(m_stats.history[(first + i) % FrameStats::kHistory] / kGraphScale, 1.0);
+        m_points[i].set(8 + i * step, graphBottom - SkDoubleToScalar(t * kGraphHeight));
+    }
+    if (count > 1) {
+        canvas.drawPoints(SkCanvas::kPolygon_PointMode, count, m_points, m_graph);
+    }
+
+    // Stacked breakdown bar: update, draw, flush, swap.
+    y = graphBottom + 6;
+    const double parts[4] = { m_stats.update, m_stats.draw, m_stats.flush, m_stats.swap };
+    SkScalar x = 8;
+    SkScalar total = kPanelWidth - 16;
+    for (int i = 0; i < 4; ++i) {
+        SkScalar w = SkDoubleToScalar(std::min(parts[i] / kGraphScale, 1.0)) * total;
+        canvas.drawRect(SkRect::MakeXYWH(x, y, w, 8), m_bars[i]);
+        x += w;
+    }
+
+    y += 8 + kLineHeight;
+    drawLine(canvas, y, snprintf(m_line, sizeof(m_line), "update %.2f  draw %.2f  flush %.2f  swap %.2f",
+        m_stats.update * 1000, m_stats.draw * 1000, m_stats.flush * 1000, m_stats.swap * 1000));
+    y += kLineHeight;
+    drawLine(canvas, y, snprintf(m_line, sizeof(m_line), "views drawn %d  culled %d  passes %d  flushes %d",
+        m_stats.viewsDrawn, m_stats.viewsCulled, m_stats.passes, m_stats.flushes));
+    if (m_stats.latency > 0) {
+        y += kLineHeight;
+        drawLine(canvas, y, snprintf(m_line, sizeof(m_line), "input latency %.2f ms  (avg %.2f ms)",
+            m_stats.latency * 1000, m_stats.averageLatency * 1000));
+    }
+    if (m_profiler) {
+        for (const GpuTiming& t : m_profiler->timings()) {
+            y += kLineHeight;
+            drawLine(canvas, y, snprintf(m_line, sizeof(m_line), "gpu %s %.2f ms  (avg %.2f ms)",
+                t.name.c_str(), t.last, t.average));
+        }
+    }
+
+    GrContext* context = canvas.getGrContext();
+    if (context) {
+        int resources = 0;
+        size_t bytes = 0;
+        int maxResources = 0;
+        size_t maxBytes = 0;
+        context->getResourceCacheUsage(&resources, &bytes);
+        context->getResourceCacheLimits(&maxResources, &maxBytes);
+        y += kLineHeight;
+        drawLine(canvas, y, snprintf(m_line, sizeof(m_line), "gpu cache %d / %d resources",
+            resources, maxResources));
+        y += kLineHeight;
+        drawLine(canvas, y, snprintf(m_line, sizeof(m_line), "gpu cache %.1f / %.1f MB",
+            bytes / (1024.0 * 1024.0), maxBytes / (1024.0 * 1024.0)));
+    }
+}
+
+void PerfHudView::onInput(const InputState& state)
+{
+    View* parent = getParent();
+    if (parent) {
+        setWH(parent->width(), parent->height());
+    }
+    if (state.isKeyPressed(m_toggleKey)) {
+        m_visible = !m_visible;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <SkPaint.h>
+
+#include "FrameStats.h"
+#include "GpuProfiler.h"
+#include "View.h"
+
+class PerfHudView : public View
+{
+    const FrameStats& m_stats;
+    const GpuProfiler* m_profiler;
+    int m_toggleKey;
+    bool m_visible;
+
+    SkPaint m_background;
+    SkPaint m_text;
+    SkPaint m_graph;
+    SkPaint m_budget;
+    SkPaint m_bars[4];
+    SkPoint m_points[FrameStats::kHistory];
+    char m_line[128];
+
+    void drawLine(SkCanvas& canvas, SkScalar y, int len);
+    void onDraw(SkCanvas& canvas) override;
+    void onInput(const InputState& state) override;
+
+public:
+    PerfHudView(const FrameStats& stats, int toggleKey = GLFW_KEY_F1);
+
+    void setGpuProfiler(const GpuProfiler* profiler) { m_profiler = profiler; }
+};
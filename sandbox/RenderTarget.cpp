@@ -17,7 +17,7 @@ RenderTarget::~RenderTarget()
 
 SkCanvas * RenderTarget::getCanvas()
 {
-    return m_surface->getCanvas();
+    return m_surface ? m_surface->getCanvas() : nullptr;
 }
 
 void RenderTarget::reset()
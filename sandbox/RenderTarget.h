@@ -12,6 +12,7 @@ public:
     ~RenderTarget();
 
     SkCanvas* getCanvas();
+    SkSurface* getSurface() { return m_surface.get(); }
     void reset();
 };
 
@@ -0,0 +1,226 @@
+#include "Scene.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#include <SkData.h>
+
+uint32_t SceneStrings::add(const std::string& str)
+{
+    auto it = m_offsets.find(str);
+    if (it != m_offsets.end()) {
+        return it->second;
+    }
+    uint32_t offset = (uint32_t)m_data.size();
+    m_data.append(str.c_str(), str.size() + 1);
+    m_offsets.emplace(str, offset);
+    return offset;
+}
+
+SceneRegistry::SceneRegistry()
+{
+    add<View>("View", [](void* memory, const SceneNode&, const SceneStringTable&) -> View* {
+        return new (memory) View();
+    });
+}
+
+void SceneRegistry::add(std::type_index type, const std::string& name, size_t size, SceneType::Construct construct, SceneType::Save save)
+{
+    m_byName[name] = m_types.size();
+    m_byType.emplace(type, m_types.size());
+    m_types.push_back({ name, size, construct, save });
+}
+
+const SceneType* SceneRegistry::find(const std::string& name) const
+{
+    auto it = m_byName.find(name);
+    return it != m_byName.end() ? &m_types[it->second] : nullptr;
+}
+
+const SceneType* SceneRegistry::find(View* view) const
+{
+    auto it = m_byType.find(typeid(*view));
+    return it != m_byType.end() ? &m_types[it->second] : nullptr;
+}
+
+Scene::Scene()
+{
+}
+
+Scene::~Scene()
+{
+    reset();
+}
+
+bool Scene::load(const std::string& path, const SceneRegistry& registry)
+{
+    reset();
+
+    sk_sp<SkData> data(SkData::MakeFromFileName(path.c_str()));
+    if (!data || data->size() < sizeof(SceneHeader)) {
+        printf("Failed to read scene %s\n", path.c_str());
+        return false;
+    }
+    const SceneHeader* header = (const SceneHeader*)data->data();
+    if (header->magic != kSceneMagic || header->version != kSceneVersion) {
+        printf("%s is not a version %u scene\n", path.c_str(), kSceneVersion);
+        return false;
+    }
+    size_t typesOffset = sizeof(SceneHeader);
+    size_t nodesOffset = typesOffset + size_t(header->typeCount) * sizeof(uint32_t);
+    size_t stringsOffset = nodesOffset + size_t(header->nodeCount) * sizeof(SceneNode);
+    if (stringsOffset + header->stringsSize > data->size()) {
+        printf("Scene %s is truncated\n", path.c_str());
+        return false;
+    }
+    const uint32_t* typeNames = (const uint32_t*)(data->bytes() + typesOffset);
+    const SceneNode* nodes = (const SceneNode*)(data->bytes() + nodesOffset);
+    SceneStringTable strings = { (const char*)data->bytes() + stringsOffset, header->stringsSize };
+    if (strings.size > 0 && strings.data[strings.size - 1] != 0) {
+        printf("Scene %s has an invalid string table\n", path.c_str());
+        return false;
+    }
+
+    const SceneType* fallback = registry.find("View");
+    std::vector<const SceneType*> types(header->typeCount);
+    for (uint32_t t = 0; t < header->typeCount; ++t) {
+        types[t] = registry.find(strings.get(typeNames[t]));
+        if (!types[t]) {
+            printf("Unknown view type %s, loading as View\n", strings.get(typeNames[t]));
+            types[t] = fallback;
+        }
+    }
+
+    std::vector<size_t> counts(header->typeCount, 0);
+    for (uint32_t i = 0; i < header->nodeCount; ++i) {
+        const SceneNode& node = nodes[i];
+        if (node.type >= header->typeCount || node.parent >= int32_t(i)) {
+            printf("Scene %s has an invalid node %u\n", path.c_str(), i);
+            return false;
+        }
+        ++counts[node.type];
+    }
+
+    // One block per type, so views of a type are constructed back to back.
+    std::vector<char*> next(header->typeCount);
+    std::vector<size_t> strides(header->typeCount);
+    for (uint32_t t = 0; t < header->typeCount; ++t) {
+        const size_t align = alignof(std::max_align_t);
+        strides[t] = (types[t]->size + align - 1) / align * align;
+        m_pools.emplace_back(new char[strides[t] * counts[t]]);
+        next[t] = m_pools.back().get();
+    }
+
+    m_views.resize(header->nodeCount);
+    for (uint32_t i = 0; i < header->nodeCount; ++i) {
+        const SceneNode& node = nodes[i];
+        View* view = types[node.type]->construct(next[node.type], node, strings);
+        next[node.type] += strides[node.type];
+        view->setXYZ(node.x, node.y, node.z);
+        view->setWH(node.width, node.height);
+        m_views[i] = view;
+
+        if (node.parent < 0) {
+            m_roots.push_back(view);
+        } else {
+            View* parent = m_views[node.parent];
+            parent->m_children.push_back(view);
+            view->m_parent = parent;
+        }
+    }
+    return true;
+}
+
+void Scene::attach(View* parent)
+{
+    for (View* v : m_roots) {
+        parent->addView(v);
+    }
+}
+
+void Scene::reset()
+{
+    for (View* v : m_roots) {
+        if (v->getParent()) {
+            v->getParent()->removeView(v);
+        }
+    }
+    // Parents come first, so each view is detached from its children before
+    // they are destroyed.
+    for (View* v : m_views) {
+        v->~View();
+    }
+    m_roots.clear();
+    m_views.clear();
+    m_pools.clear();
+}
+
+static void collectNodes(View* view, int32_t parent, const SceneRegistry& registry, std::vector<SceneNode>& nodes,
+                         std::unordered_map<const SceneType*, uint32_t>& typeIndices, std::vector<uint32_t>& typeNames,
+                         SceneStrings& strings)
+{
+    const SceneType* type = registry.find(view);
+    if (!type) {
+        printf("View type %s is not registered, skipping subtree\n", typeid(*view).name());
+        return;
+    }
+    auto it = typeIndices.find(type);
+    if (it == typeIndices.end()) {
+        it = typeIndices.emplace(type, (uint32_t)typeNames.size()).first;
+        typeNames.push_back(strings.add(type->name));
+    }
+
+    SceneNode node;
+    memset(&node, 0, sizeof(node));
+    node.parent = parent;
+    node.type = it->second;
+    node.x = view->x();
+    node.y = view->y();
+    node.z = view->z();
+    node.width = view->width();
+    node.height = view->height();
+    if (type->save) {
+        type->save(view, node, strings);
+    }
+
+    int32_t index = (int32_t)nodes.size();
+    nodes.push_back(node);
+    for (View* v : view->children()) {
+        collectNodes(v, index, registry, nodes, typeIndices, typeNames, strings);
+    }
+}
+
+bool writeScene(const std::string& path, View* root, const SceneRegistry& registry)
+{
+    std::vector<SceneNode> nodes;
+    std::unordered_map<const SceneType*, uint32_t> typeIndices;
+    std::vector<uint32_t> typeNames;
+    SceneStrings strings;
+    for (View* v : root->children()) {
+        collectNodes(v, -1, registry, nodes, typeIndices, typeNames, strings);
+    }
+
+    SceneHeader header;
+    header.magic = kSceneMagic;
+    header.version = kSceneVersion;
+    header.typeCount = (uint32_t)typeNames.size();
+    header.nodeCount = (uint32_t)nodes.size();
+    header.stringsSize = (uint32_t)strings.data().size();
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        printf("Failed to open %s for writing\n", path.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(typeNames.data(), sizeof(uint32_t), typeNames.size(), file) == typeNames.size();
+    ok = ok && fwrite(nodes.data(), sizeof(SceneNode), nodes.size(), file) == nodes.size();
+    ok = ok && fwrite(strings.data().data(), 1, strings.data().size(), file) == strings.data().size();
+    fclose(file);
+    if (!ok) {
+        printf("Failed to write scene %s\n", path.c_str());
+    }
+    return ok;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include "SceneFormat.h"
+#include "View.h"
+
+struct SceneStringTable
+{
+    const char* data;
+    uint32_t size;
+
+    const char* get(uint32_t offset) const { return offset < size ? data + offset : ""; }
+};
+
+class SceneStrings
+{
+    std::string m_data;
+    std::unordered_map<std::string, uint32_t> m_offsets;
+
+public:
+    uint32_t add(const std::string& str);
+    const std::string& data() const { return m_data; }
+};
+
+struct SceneType
+{
+    typedef View* (*Construct)(void* memory, const SceneNode& node, const SceneStringTable& strings);
+    typedef void (*Save)(View* view, SceneNode& node, SceneStrings& strings);
+
+    std::string name;
+    size_t size;
+    Construct construct;
+    Save save;
+};
+
+class SceneRegistry
+{
+    std::vector<SceneType> m_types;
+    std::unordered_map<std::string, size_t> m_byName;
+    std::unordered_map<std::type_index, size_t> m_byType;
+
+    void add(std::type_index type, const std::string& name, size_t size, SceneType::Construct construct, SceneType::Save save);
+
+public:
+    SceneRegistry();
+
+    template <typename T>
+    void add(const std::string& name, SceneType::Construct construct, SceneType::Save save = nullptr)
+    {
+        add(typeid(T), name, sizeof(T), construct, save);
+    }
+
+    const SceneType* find(const std::string& name) const;
+    const SceneType* find(View* view) const;
+};
+
+class Scene
+{
+    std::vector<std::unique_ptr<char[]>> m_pools;
+    std::vector<View*> m_views;
+    std::vector<View*> m_roots;
+
+public:
+    Scene();
+    ~Scene();
+
+    bool load(const std::string& path, const SceneRegistry& registry);
+    void attach(View* parent);
+    void reset();
+
+    size_t size() const { return m_views.size(); }
+};
+
+bool writeScene(const std::string& path, View* root, const SceneRegistry& registry);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+// Layout of a scene file, all little-endian:
+//   SceneHeader
+//   uint32_t typeNames[typeCount]    offsets into the string table
+//   SceneNode nodes[nodeCount]       pre-order, parents before children
+//   char strings[stringsSize]        zero-terminated strings
+
+const uint32_t kSceneMagic = 0x4e435353;
+const uint32_t kSceneVersion = 1;
+
+struct SceneHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t typeCount;
+    uint32_t nodeCount;
+    uint32_t stringsSize;
+};
+
+union SceneArg
+{
+    uint32_t u;
+    int32_t i;
+    float f;
+};
+
+struct SceneNode
+{
+    int32_t parent;
+    uint32_t type;
+    float x;
+    float y;
+    float z;
+    float width;
+    float height;
+    SceneArg args[4];
+};
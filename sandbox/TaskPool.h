@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskPool
+{
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop;
+
+    void work();
+
+public:
+    TaskPool(int threads = 0);
+    ~TaskPool();
+
+    void add(std::function<void()> task);
+    int threadCount() const { return (int)m_threads.size(); }
+};
+
+class TaskGroup
+{
+    TaskPool& m_pool;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    int m_pending;
+
+public:
+    TaskGroup(TaskPool& pool);
+    ~TaskGroup();
+
+    void add(std::function<void()> task);
+    void wait();
+};
@@ -1,11 +1,26 @@
 #include "View.h"
 
+#include <SkPictureRecorder.h>
+
+#include "GpuProfiler.h"
+
+std::atomic<int> View::s_drawn(0);
+std::atomic<int> View::s_culled(0);
+std::atomic<int> View::s_flushes(0);
+
 View::View()
+    : m_parent(nullptr)
+    , m_hasSnapshot(false)
+    , m_contentInBounds(false)
 {
 }
 
 View::~View()
 {
+    // Views live on the stack, so a child may die before its parent.
+    if (m_parent) {
+        m_parent->removeView(this);
+    }
     auto copy = m_children;
     for (View* v : copy) {
         removeView(v);
@@ -23,6 +38,7 @@ void View::addView(View* view)
     }
     m_children.emplace_back(view);
     view->m_parent = this;
+    view->m_hasSnapshot = false;
 }
 
 void View::removeView(View* view)
@@ -66,16 +82,152 @@ bool View::containsPoint(SkPoint point, View * reference)
     return localRect().intersects(p.x(), p.y(), p.x() + 1, p.y() + 1);
 }
 
-void View::draw(SkCanvas & canvas)
+bool View::childrenInBounds()
+{
+    SkRect local = m_drawProps.localRect();
+    for (View* v : m_children) {
+        SkRect bounds;
+        v->m_drawProps.matrix().mapRect(&bounds, v->m_drawProps.localRect());
+        if (!local.contains(bounds)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool View::prepareCanvas(SkCanvas& canvas, bool recording)
+{
+    canvas.concat(m_drawProps.matrix());
+    SkRect local = m_drawProps.localRect();
+    // Everything a view draws is clipped to, or declared inside, its rect.
+    if (canvas.quickReject(local)) {
+        ++s_culled;
+        return false;
+    }
+    ++s_drawn;
+    if (m_contentInBounds && childrenInBounds()) {
+        return true;
+    }
+    // Integer translations land the rect on pixel edges, where a non-AA clip
+    // is exact and stays a scissor instead of a coverage mask. A recording
+    // only sees its own matrix, not the one it is played back under, so it
+    // keeps the AA clip.
+    const SkMatrix& total = canvas.getTotalMatrix();
+    bool aligned = !recording && total.isTranslate() &&
+        SkScalarIsInt(total.getTranslateX()) && SkScalarIsInt(total.getTranslateY()) &&
+        SkScalarIsInt(local.width()) && SkScalarIsInt(local.height());
+    canvas.clipRect(local, SkRegion::kIntersect_Op, !aligned);
+    return true;
+}
+
+void View::takeDrawCounts(int* drawn, int* culled, int* flushes)
+{
+    *drawn = s_drawn.exchange(0);
+    *culled = s_culled.exchange(0);
+    *flushes = s_flushes.exchange(0);
+}
+
+void View::flush(SkCanvas& canvas)
+{
+    canvas.flush();
+    ++s_flushes;
+}
+
+// Visits the views that will survive culling in draw, using device space
+// bounds, and lets them queue offscreen work for the frame.
+void View::schedulePasses(PassScheduler& scheduler, const SkMatrix& parent, const SkRect& clip)
+{
+    SkMatrix matrix = SkMatrix::Concat(parent, m_drawProps.matrix());
+    SkRect bounds;
+    matrix.mapRect(&bounds, m_drawProps.localRect());
+    if (!bounds.intersect(clip)) {
+        return;
+    }
+    onSchedulePasses(scheduler);
+    for (View* v : m_children) {
+        v->schedulePasses(scheduler, matrix, bounds);
+    }
+}
+
+void View::draw(SkCanvas & canvas, bool recording)
+{
+    SkAutoCanvasRestore restore(&canvas, true);
+    if (!prepareCanvas(canvas, recording)) {
+        return;
+    }
+
+    onDraw(canvas);
+
+    for (View* v : m_children) {
+        v->draw(canvas, recording);
+    }
+}
+
+bool View::isSubtreeThreadSafe()
+{
+    if (!isRecordingThreadSafe()) {
+        return false;
+    }
+    for (View* v : m_children) {
+        if (!v->isSubtreeThreadSafe()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void View::recordChildren(TaskGroup& group, int depth)
+{
+    for (View* v : m_children) {
+        if (v->isSubtreeThreadSafe()) {
+            group.add([v] {
+                SkRect bounds;
+                v->m_drawProps.matrix().mapRect(&bounds, v->m_drawProps.localRect());
+                SkPictureRecorder recorder;
+                v->draw(*recorder.beginRecording(bounds), true);
+                v->m_recording = recorder.finishRecordingAsPicture();
+            });
+        } else if (depth > 0) {
+            v->recordChildren(group, depth - 1);
+        }
+    }
+}
+
+void View::drawRecorded(SkCanvas& canvas)
 {
     SkAutoCanvasRestore restore(&canvas, true);
-    canvas.concat(m_props.matrix());
-    canvas.clipRect(m_props.localRect(), SkRegion::kIntersect_Op, true);
+    if (!prepareCanvas(canvas, false)) {
+        return;
+    }
 
     onDraw(canvas);
 
     for (View* v : m_children) {
+        if (v->m_recording) {
+            canvas.drawPicture(v->m_recording);
+            v->m_recording.reset();
+        } else {
+            v->drawRecorded(canvas);
+        }
+    }
+}
+
+void View::drawProfiled(SkCanvas& canvas)
+{
+    SkAutoCanvasRestore restore(&canvas, true);
+    if (!prepareCanvas(canvas, false)) {
+        return;
+    }
+
+    onDraw(canvas);
+
+    // Skia only issues GL work when flushed, so each subtree is flushed inside
+    // its own scope.
+    flush(canvas);
+    for (View* v : m_children) {
+        GPU_SCOPE(v->name().empty() ? "View" : v->name());
         v->draw(canvas);
+        flush(canvas);
     }
 }
 
@@ -93,6 +245,43 @@ bool View::update(const InputState & state)
     return onUpdate(state);
 }
 
+void View::dispatchInput(const InputState& state)
+{
+    onInput(state);
+    for (View* v : m_children) {
+        v->dispatchInput(state);
+    }
+}
+
+void View::latch(const InputState& state)
+{
+    onLatch(state);
+    for (View* v : m_children) {
+        v->latch(state);
+    }
+}
+
+// Snapshots the properties before each fixed step so draws can be
+// interpolated between the last two steps.
+void View::tick(double dt)
+{
+    m_prevProps = m_props;
+    m_hasSnapshot = true;
+    onTick(dt);
+    for (View* v : m_children) {
+        v->tick(dt);
+    }
+}
+
+void View::interpolate(SkScalar alpha)
+{
+    m_drawProps = m_hasSnapshot && alpha < 1 ? ViewProperties::lerp(m_prevProps, m_props, alpha) : m_props;
+    onInterpolate(alpha);
+    for (View* v : m_children) {
+        v->interpolate(alpha);
+    }
+}
+
 void View::exit()
 {
     onExit();
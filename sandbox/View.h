@@ -1,10 +1,15 @@
 #pragma once
 
+#include <atomic>
 #include <list>
+#include <string>
 
 #include <SkCanvas.h>
+#include <SkPicture.h>
 
 #include "InputState.h"
+#include "PassScheduler.h"
+#include "TaskPool.h"
 
 struct ViewProperties
 {
@@ -20,6 +25,17 @@ struct ViewProperties
     {
     }
 
+    static ViewProperties lerp(const ViewProperties& a, const ViewProperties& b, SkScalar t)
+    {
+        ViewProperties p;
+        p.width = a.width + (b.width - a.width) * t;
+        p.height = a.height + (b.height - a.height) * t;
+        p.x = a.x + (b.x - a.x) * t;
+        p.y = a.y + (b.y - a.y) * t;
+        p.z = a.z + (b.z - a.z) * t;
+        return p;
+    }
+
     SkRect localRect() { return SkRect::MakeWH(width, height); }
     SkMatrix matrix()
     {
@@ -31,27 +47,71 @@ struct ViewProperties
 
 class View
 {
+    friend class Scene;
+
     std::list<View*> m_children;
     View* m_parent;
 
     ViewProperties m_props;
+    ViewProperties m_prevProps;
+    ViewProperties m_drawProps;
+    bool m_hasSnapshot;
+    sk_sp<SkPicture> m_recording;
+    std::string m_name;
+    bool m_contentInBounds;
+
+    static std::atomic<int> s_drawn;
+    static std::atomic<int> s_culled;
+    static std::atomic<int> s_flushes;
+
+    bool isSubtreeThreadSafe();
+    bool childrenInBounds();
+    bool prepareCanvas(SkCanvas& canvas, bool recording);
 
     virtual void onDraw(SkCanvas& canvas) {}
     virtual bool onUpdate(const InputState& state) { return false; }
+    virtual void onLatch(const InputState& state) {}
+    // Called for every view once per input poll, before update, regardless of
+    // where the cursor is.
+    virtual void onInput(const InputState& state) {}
+    virtual void onSchedulePasses(PassScheduler& scheduler) {}
+    virtual void onTick(double dt) {}
+    virtual void onInterpolate(SkScalar alpha) {}
     virtual void onExit() {}
 
 protected:
-    void draw(SkCanvas& canvas);
+    static void flush(SkCanvas& canvas);
+
+    void schedulePasses(PassScheduler& scheduler, const SkMatrix& parent, const SkRect& clip);
+    void draw(SkCanvas& canvas, bool recording = false);
+    void recordChildren(TaskGroup& group, int depth);
+    void drawRecorded(SkCanvas& canvas);
+    void drawProfiled(SkCanvas& canvas);
+    void dispatchInput(const InputState& state);
     bool update(const InputState& state);
+    void latch(const InputState& state);
+    void tick(double dt);
+    void interpolate(SkScalar alpha);
     void exit();
 
 public:
     View();
     virtual ~View();
 
+    virtual bool isRecordingThreadSafe() const { return false; }
+    static void takeDrawCounts(int* drawn, int* culled, int* flushes);
+
     void addView(View* view);
     void removeView(View* view);
     View* getParent();
+    const std::string& name() const { return m_name; }
+    void setName(const std::string& name) { m_name = name; }
+    const std::list<View*>& children() const { return m_children; }
+
+    // Declares that onDraw never paints outside localRect, which lets draw skip
+    // the clip when the children stay inside as well.
+    void setContentInBounds(bool inBounds) { m_contentInBounds = inBounds; }
+    bool contentInBounds() const { return m_contentInBounds; }
 
     SkScalar x() { return m_props.x; }
     SkScalar y() { return m_props.y; }
@@ -61,6 +121,13 @@ public:
     int widthI() { return SkScalarTruncToInt(width()); }
     int heightI() { return SkScalarTruncToInt(height()); }
     SkRect localRect() { return m_props.localRect(); }
+    // The interpolated size the current frame is drawn at. Drawing and pass
+    // setup use these so content matches the clip and transform.
+    SkScalar drawWidth() { return m_drawProps.width; }
+    SkScalar drawHeight() { return m_drawProps.height; }
+    int drawWidthI() { return SkScalarTruncToInt(drawWidth()); }
+    int drawHeightI() { return SkScalarTruncToInt(drawHeight()); }
+    SkRect drawRect() { return m_drawProps.localRect(); }
     SkMatrix matrix() { return m_props.matrix(); }
     SkMatrix currentTransformMatrix(View* ancestor = nullptr);
     SkPoint convertToLocal(SkPoint point, View* reference = nullptr);
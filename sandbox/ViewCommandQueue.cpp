@@ -0,0 +1,74 @@
+#include "ViewCommandQueue.h"
+
+ViewCommandQueue::ViewCommandQueue()
+    : m_head(nullptr)
+{
+}
+
+ViewCommandQueue::~ViewCommandQueue()
+{
+    Command* c = m_head.exchange(nullptr);
+    while (c) {
+        Command* next = c->next;
+        delete c;
+        c = next;
+    }
+}
+
+void ViewCommandQueue::post(Type type, View* view, View* child, SkScalar a, SkScalar b)
+{
+    Command* c = new Command{ type, view, child, a, b, false, nullptr };
+    Command* head = m_head.load(std::memory_order_relaxed);
+    do {
+        c->next = head;
+    } while (!m_head.compare_exchange_weak(head, c, std::memory_order_release, std::memory_order_relaxed));
+}
+
+int ViewCommandQueue::apply()
+{
+    // Producers push onto a stack, so the drained list runs newest to oldest.
+    // Walking it in that order lets older sets of an already-set property be
+    // skipped before everything is applied oldest first.
+    Command* c = m_head.exchange(nullptr, std::memory_order_acquire);
+    if (!c) {
+        return 0;
+    }
+    for (; c; c = c->next) {
+        if (c->type == Type::SetXY || c->type == Type::SetZ || c->type == Type::SetWH) {
+            unsigned bit = 1u << unsigned(c->type);
+            unsigned& seen = m_seen[c->view];
+            c->skip = (seen & bit) != 0;
+            seen |= bit;
+        }
+        m_batch.push_back(c);
+    }
+
+    int applied = 0;
+    for (auto it = m_batch.rbegin(); it != m_batch.rend(); ++it) {
+        Command* cmd = *it;
+        if (!cmd->skip) {
+            switch (cmd->type) {
+            case Type::SetXY:
+                cmd->view->setXY(cmd->a, cmd->b);
+                break;
+            case Type::SetZ:
+                cmd->view->setZ(cmd->a);
+                break;
+            case Type::SetWH:
+                cmd->view->setWH(cmd->a, cmd->b);
+                break;
+            case Type::AddView:
+                cmd->view->addView(cmd->child);
+                break;
+            case Type::RemoveView:
+                cmd->view->removeView(cmd->child);
+                break;
+            }
+            ++applied;
+        }
+        delete cmd;
+    }
+    m_batch.clear();
+    m_seen.clear();
+    return applied;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include "View.h"
+
+class ViewCommandQueue
+{
+    enum class Type
+    {
+        SetXY,
+        SetZ,
+        SetWH,
+        AddView,
+        RemoveView,
+    };
+
+    struct Command
+    {
+        Type type;
+        View* view;
+        View* child;
+        SkScalar a;
+        SkScalar b;
+        bool skip;
+        Command* next;
+    };
+
+    std::atomic<Command*> m_head;
+    std::vector<Command*> m_batch;
+    std::unordered_map<View*, unsigned> m_seen;
+
+    void post(Type type, View* view, View* child, SkScalar a, SkScalar b);
+
+public:
+    ViewCommandQueue();
+    ~ViewCommandQueue();
+
+    void setXY(View* view, SkScalar x, SkScalar y) { post(Type::SetXY, view, nullptr, x, y); }
+    void setZ(View* view, SkScalar z) { post(Type::SetZ, view, nullptr, z, 0); }
+    void setWH(View* view, SkScalar width, SkScalar height) { post(Type::SetWH, view, nullptr, width, height); }
+    void addView(View* parent, View* child) { post(Type::AddView, parent, child, 0, 0); }
+    void removeView(View* parent, View* child) { post(Type::RemoveView, parent, child, 0, 0); }
+
+    int apply();
+};
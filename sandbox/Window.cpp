@@ -1,12 +1,34 @@
 #include <GL/glew.h>
 #include "Window.h"
 
+#include <algorithm>
+#include <cmath>
+#include <csignal>
 #include <vector>
 #include <string>
 #include <unordered_map>
 
-Window::Window(int width, int height, const std::string& title)
-    : m_title(title)
+#include "Clock.h"
+#include "CubeMapBatch.h"
+
+// Headless runs have no window to close, so SIGINT and SIGTERM end the loop
+// and let exit() and the capture drain run.
+static volatile std::sig_atomic_t s_interrupted = 0;
+
+Window::Window(int width, int height, const std::string& title, WindowBackend backend)
+    : m_window(nullptr)
+    , m_lastFrameEnd(0)
+    , m_recordingDepth(0)
+    , m_captureRate(0)
+    , m_tickRate(0)
+    , m_maxTicks(4)
+    , m_lastTick(0)
+    , m_tickAccumulator(0)
+    , m_title(title)
+    , m_backend(backend)
+    , m_closeRequested(false)
+    , m_frameLimit(0)
+    , m_frameCount(0)
 {
     setWH(SkIntToScalar(width), SkIntToScalar(height));
 }
@@ -17,6 +39,39 @@ Window::~Window()
 }
 
 bool Window::init()
+{
+    if (m_backend == WindowBackend::Headless) {
+        if (!m_headless.init()) {
+            return false;
+        }
+        std::signal(SIGINT, Window::signal_callback);
+        std::signal(SIGTERM, Window::signal_callback);
+    } else if (!initGlfw()) {
+        return false;
+    }
+    bool ready = m_backend == WindowBackend::Headless ? m_gc.init(m_headless.createInterface()) : m_gc.init();
+    if (!ready) {
+        reset();
+        return false;
+    }
+
+    GLenum err = glewInit();
+    if (err != GLEW_OK) {
+        printf("glewInit error: %s\n", glewGetErrorString(err));
+    }
+
+    printf("OpenGL %s, GLSL %s\n", glGetString(GL_VERSION), glGetString(GL_SHADING_LANGUAGE_VERSION));
+
+    resize(widthI(), heightI());
+    if (!m_defaultTarget.getSurface()) {
+        printf("Failed to create the default render target\n");
+        reset();
+        return false;
+    }
+    return true;
+}
+
+bool Window::initGlfw()
 {
     glfwWindowHint(GLFW_STENCIL_BITS, 16);
     m_window = glfwCreateWindow(widthI(), heightI(), m_title.c_str(), NULL, NULL);
@@ -31,40 +86,155 @@ bool Window::init()
     glfwSetWindowRefreshCallback(m_window, Window::refresh_callback);
 
     glfwMakeContextCurrent(m_window);
-    glfwSwapInterval(1);
-    m_gc.init();
+    glfwSwapInterval(m_pacer.settings().swapInterval);
 
-    GLenum err = glewInit();
-    if (err != GLEW_OK) {
-        printf("glewInit error: %s\n", glewGetErrorString(err));
+    const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    if (mode) {
+        m_pacer.setRefreshRate(mode->refreshRate);
     }
-
-    printf("OpenGL %s, GLSL %s\n", glGetString(GL_VERSION), glGetString(GL_SHADING_LANGUAGE_VERSION));
-
-    resize(widthI(), heightI());
     return true;
 }
 
 void Window::reset()
 {
+    m_capture.stop();
+    if (m_profiler) {
+        m_profiler->release();
+    }
+    if (m_viewBatch) {
+        m_viewBatch->release();
+    }
     m_defaultTarget.reset();
     m_gc.reset();
-    glfwDestroyWindow(m_window);
-    m_window = nullptr;
+    m_headless.reset();
+    if (m_window) {
+        glfwDestroyWindow(m_window);
+        m_window = nullptr;
+    }
 }
 
-void Window::run()
+bool Window::run()
 {
     if (init()) {
-        while (!glfwWindowShouldClose(m_window)) {
-            update(m_input);
-            m_input.poll();
+        int interval = m_pacer.settings().swapInterval;
+        if (m_captureRate > 0) {
+            m_capture.setFrameRate(m_captureRate);
+        } else if (m_window && interval > 0) {
+            m_capture.setFrameRate(1 / (m_pacer.refreshPeriod() * interval));
+        } else {
+            m_capture.setFrameRate(0);
+        }
+        while (!shouldClose()) {
+            m_pacer.wait();
+            pollEvents();
+            double start = clockSeconds();
+            m_commands.apply();
+            if (m_tickRate > 0) {
+                runTicks(start);
+            } else {
+                dispatchInput(m_input);
+                update(m_input);
+                m_input.poll();
+                interpolate(1);
+                m_stats.ticks = 1;
+            }
+            if (m_pacer.settings().lateLatch) {
+                pollEvents();
+                latch(m_input);
+            }
+            m_stats.update = clockSeconds() - start;
             beginDraw();
-            glfwSwapBuffers(m_window);
-            glfwPollEvents();
+            start = clockSeconds();
+            swapBuffers();
+            double end = clockSeconds();
+            m_stats.swap = end - start;
+            if (m_lastFrameEnd > 0) {
+                m_stats.push(end - m_lastFrameEnd);
+            }
+            m_lastFrameEnd = end;
+        }
+        if (m_pacer.latencySamples() > 0) {
+            printf("Input latency: avg %.2f ms over %d frames\n",
+                m_pacer.averageLatency() * 1000, m_pacer.latencySamples());
+        }
+        if (m_profiler) {
+            m_profiler->print();
         }
         exit();
         reset();
+        return true;
+    }
+    return false;
+}
+
+// Runs as many fixed steps as the elapsed time covers, up to m_maxTicks. Time
+// beyond that is dropped so a slow frame doesn't snowball into slower ones.
+// Input is polled after every step, so press edges and the cursor delta reach
+// only the first step; later ones see held keys as down with no movement. A
+// frame that runs no steps leaves the edges pending for the next one.
+void Window::runTicks(double now)
+{
+    const double dt = 1 / m_tickRate;
+    m_tickAccumulator = m_lastTick > 0 ? m_tickAccumulator + now - m_lastTick : dt;
+    m_lastTick = now;
+    int ticks = 0;
+    while (m_tickAccumulator >= dt && ticks < m_maxTicks) {
+        tick(dt);
+        dispatchInput(m_input);
+        update(m_input);
+        m_input.poll();
+        m_tickAccumulator -= dt;
+        ++ticks;
+    }
+    if (m_tickAccumulator >= dt) {
+        m_tickAccumulator = std::fmod(m_tickAccumulator, dt);
+    }
+    m_stats.ticks = ticks;
+    interpolate(SkScalar(m_tickAccumulator / dt));
+}
+
+bool Window::shouldClose()
+{
+    if (m_frameLimit > 0 && m_frameCount >= m_frameLimit) {
+        return true;
+    }
+    if (m_window) {
+        return glfwWindowShouldClose(m_window) != 0;
+    }
+    return m_closeRequested || s_interrupted;
+}
+
+void Window::pollEvents()
+{
+    if (m_window) {
+        glfwPollEvents();
+    }
+}
+
+void Window::swapBuffers()
+{
+    if (m_capture.isRunning()) {
+        if (m_capture.capture(m_defaultTarget.getSurface(), m_backend == WindowBackend::Headless ? m_headless.framebuffer() : 0)) {
+            m_gc.resetState();
+        }
+    }
+    m_pacer.submitted();
+    if (m_window) {
+        glfwSwapBuffers(m_window);
+    } else {
+        glFinish();
+    }
+    if (m_pacer.settings().waitsForPresent()) {
+        glFinish();
+        m_pacer.presented(m_input.eventTime());
+        m_stats.latency = m_pacer.latency();
+        m_stats.averageLatency = m_pacer.averageLatency();
+    }
+    m_input.clearEventTime();
+    ++m_frameCount;
+
+    if (m_profiler) {
+        m_profiler->endFrame();
     }
 }
 
@@ -73,16 +243,41 @@ void Window::resize(int width, int height)
     if (width <= 0) width = 1;
     if (height <= 0) height = 1;
     setWH(SkIntToScalar(width), SkIntToScalar(height));
-    m_defaultTarget = m_gc.createDefaultTarget(width, height, 16);
+    if (m_backend == WindowBackend::Headless) {
+        m_defaultTarget.reset();
+        if (m_headless.resize(width, height)) {
+            m_defaultTarget = m_gc.createDefaultTarget(width, height, 8, m_headless.framebuffer());
+        }
+    } else {
+        m_defaultTarget = m_gc.createDefaultTarget(width, height, 16);
+    }
 }
 
 void Window::beginDraw()
 {
     SkCanvas* canvas = m_defaultTarget.getCanvas();
     if (canvas) {
+        double start = clockSeconds();
+        m_passes.begin(canvas->getGrContext());
+        schedulePasses(m_passes, SkMatrix::I(), drawRect());
+        m_passes.run();
         canvas->clear(SK_ColorBLACK);
-        draw(*canvas);
-        canvas->flush();
+        if (m_profiler) {
+            drawProfiled(*canvas);
+        } else if (m_recordPool) {
+            TaskGroup group(*m_recordPool);
+            recordChildren(group, m_recordingDepth);
+            group.wait();
+            drawRecorded(*canvas);
+        } else {
+            draw(*canvas);
+        }
+        double flushStart = clockSeconds();
+        flush(*canvas);
+        m_stats.draw = flushStart - start;
+        m_stats.flush = clockSeconds() - flushStart;
+        m_stats.passes = m_passes.passCount();
+        View::takeDrawCounts(&m_stats.viewsDrawn, &m_stats.viewsCulled, &m_stats.flushes);
     }
 }
 
@@ -101,13 +296,73 @@ void Window::onButton(int button, int action)
     m_input.setButton(button, action);
 }
 
-void Window::show()
+bool Window::show()
+{
+    return run();
+}
+
+void Window::setLatencySettings(const LatencySettings& settings)
+{
+    m_pacer.setSettings(settings);
+    if (m_window) {
+        glfwSwapInterval(settings.swapInterval);
+    }
+}
+
+void Window::setTickRate(double hz, int maxTicksPerFrame)
+{
+    m_tickRate = hz;
+    m_maxTicks = std::max(maxTicksPerFrame, 1);
+    m_lastTick = 0;
+}
+
+void Window::setParallelRecording(bool enabled, int depth)
+{
+    if (enabled && !m_recordPool) {
+        m_recordPool.reset(new TaskPool());
+    } else if (!enabled) {
+        m_recordPool.reset();
+    }
+    m_recordingDepth = depth;
+}
+
+void Window::setGpuProfiling(bool enabled)
+{
+    if (enabled && !m_profiler) {
+        m_profiler.reset(new GpuProfiler());
+    } else if (!enabled && m_profiler) {
+        m_profiler->release();
+        m_profiler.reset();
+    }
+    GpuProfiler::setCurrent(m_profiler.get());
+}
+
+void Window::setViewBatching(bool enabled)
+{
+    if (enabled && !m_viewBatch) {
+        m_viewBatch.reset(new CubeMapBatch());
+    } else if (!enabled && m_viewBatch) {
+        m_viewBatch->release();
+        m_viewBatch.reset();
+    }
+}
+
+// Without an explicit fps the video runs at the vsync rate, or at the
+// measured rate when nothing locks the loop to the display.
+bool Window::startCapture(const std::string& path, CaptureFormat format, double fps)
 {
-    run();
+    m_captureRate = fps;
+    return m_capture.start(path, format);
+}
+
+void Window::stopCapture()
+{
+    m_capture.stop();
 }
 
 void Window::close()
 {
+    m_closeRequested = true;
     if (m_window) {
         glfwSetWindowShouldClose(m_window, GLFW_TRUE);
     }
@@ -152,4 +407,9 @@ void Window::mouse_button_callback(GLFWwindow * w, int button, int action, int m
 {
     Window* window = (Window*)glfwGetWindowUserPointer(w);
     window->onButton(button, action);
+}
+
+void Window::signal_callback(int signal)
+{
+    s_interrupted = 1;
 }
\ No newline at end of file
@@ -1,25 +1,66 @@
 #pragma once
 
 #include <list>
+#include <memory>
 #include <string>
 
 #include "glfw.h"
 #include "InputState.h"
+#include "FrameCapture.h"
+#include "FramePacer.h"
+#include "FrameStats.h"
+#include "GpuProfiler.h"
 #include "GraphicsContext.h"
+#include "HeadlessContext.h"
+#include "PassScheduler.h"
 #include "View.h"
+#include "ViewCommandQueue.h"
+
+class CubeMapBatch;
+
+enum class WindowBackend
+{
+    Glfw,
+    Headless,
+};
 
 class Window : public View
 {
     InputState m_input;
     GLFWwindow* m_window;
+    HeadlessContext m_headless;
     GraphicsContext m_gc;
     RenderTarget m_defaultTarget;
+    FramePacer m_pacer;
+    FrameStats m_stats;
+    double m_lastFrameEnd;
+    std::unique_ptr<TaskPool> m_recordPool;
+    int m_recordingDepth;
+    std::unique_ptr<GpuProfiler> m_profiler;
+    std::unique_ptr<CubeMapBatch> m_viewBatch;
+    FrameCapture m_capture;
+    double m_captureRate;
+    ViewCommandQueue m_commands;
+    PassScheduler m_passes;
+    double m_tickRate;
+    int m_maxTicks;
+    double m_lastTick;
+    double m_tickAccumulator;
 
     std::string m_title;
+    WindowBackend m_backend;
+    bool m_closeRequested;
+    int m_frameLimit;
+    int m_frameCount;
 
     bool init();
+    bool initGlfw();
     void reset();
-    void run();
+    bool run();
+    void runTicks(double now);
+    bool shouldClose();
+    void pollEvents();
+    void swapBuffers();
     void resize(int width, int height);
     void beginDraw();
     void onKey(int key, int action);
@@ -31,12 +72,26 @@ class Window : public View
     static void refresh_callback(GLFWwindow* w);
     static void cursor_position_callback(GLFWwindow* w, double x, double y);
     static void mouse_button_callback(GLFWwindow* w, int button, int action, int mods);
+    static void signal_callback(int signal);
 
 public:
-    Window(int width, int height, const std::string& title);
+    Window(int width, int height, const std::string& title, WindowBackend backend = WindowBackend::Glfw);
     ~Window();
 
-    void show();
+    bool show();
     void close();
+    void setFrameLimit(int frames) { m_frameLimit = frames; }
+    ViewCommandQueue& commands() { return m_commands; }
+    void setTickRate(double hz, int maxTicksPerFrame = 4);
+    void setLatencySettings(const LatencySettings& settings);
+    const FramePacer& pacer() const { return m_pacer; }
+    const FrameStats& frameStats() const { return m_stats; }
+    void setParallelRecording(bool enabled, int depth = 0);
+    void setGpuProfiling(bool enabled);
+    const GpuProfiler* gpuProfiler() const { return m_profiler.get(); }
+    void setViewBatching(bool enabled);
+    CubeMapBatch* viewBatch() { return m_viewBatch.get(); }
+    bool startCapture(const std::string& path, CaptureFormat format, double fps = 0);
+    void stopCapture();
 };
 